@@ -15,18 +15,72 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <x86intrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
-#define MAX_VESSELS          120
-#define MAX_VESSEL_NAME_LEN  128
+#define MAX_INPUT_LEN        256
 #define MAX_LEN_FEET         100
 #define MAX_SLIP_NUM         85
 #define MAX_STORAGE_LOC      50
+#define MAX_WORKERS          64
+#define BENCH_DEFAULT_ROWS   1000000
+#define MIN_RECORDS_PER_WORKER 1024
+#define FLEET_INITIAL_CAPACITY 64
+#define POOL_MIN_SLAB        256
+#define POOL_MAX_SLAB        65536
+#define NAME_CHUNK_SIZE      (64 * 1024)
+#define NAME_INDEX_MIN_SLOTS 64
+#define TREE_FANOUT          32
+#define TREE_MIN_FILL        (TREE_FANOUT / 2)
+#define TREE_BUILD_FILL      (TREE_FANOUT * 3 / 4)
+#define TOMBSTONE_RATIO      4          /* purge when over 1 in this many are removed */
+#define MAX_SUGGESTIONS      5
+#define MAX_BAYS             26         /* bays A-Z */
+#define TAG_INDEX_MIN_SLOTS  64
+#define BITSET_WORDS(bits)   (((bits) + 63) / 64)
+#define MAX_REPORTED_LINES   10         /* unreadable data file lines printed */
 
-/* Monthly billing rates (dollars per foot) */
-#define RATE_SLIP      12.50
-#define RATE_LAND      14.00
-#define RATE_TRAILER   25.00
-#define RATE_STORAGE   11.20
+/* Binary snapshot file layout */
+#define SNAPSHOT_MAGIC       "BOATSNAP"
+#define SNAPSHOT_VERSION     1
+
+/* Write-ahead journal kept next to the data file */
+#define JOURNAL_SUFFIX       ".journal"
+#define PARTIAL_SUFFIX       ".partial"     /* saves after a lossy load go here */
+#define JOURNAL_COMPACT_DEFAULT 1000
+#define MAX_PATH_LEN         1024
+
+/* Read size of the streaming month-end billing pass */
+#define STREAM_BLOCK_SIZE    (1 << 20)
+
+/* Size of the output builder's buffer */
+#define OUTBUF_SIZE          (1 << 20)
+
+/*
+ * Monthly billing rates in cents per foot.  Lengths are kept in hundredths
+ * of a foot, as precise as the data files write them, and each month's
+ * charge is rounded to the nearest cent once, as the float code did.
+ */
+#define RATE_SLIP      1250
+#define RATE_LAND      1400
+#define RATE_TRAILER   2500
+#define RATE_STORAGE   1120
 
 /* Enum for location categories */
 typedef enum {
@@ -44,42 +98,757 @@ typedef union {
     int  storageSpot;           /* For STORAGE (1–50)    */
 } LocDetails;
 
-/* Struct for each vessel’s information */
-typedef struct {
-    char            vesselName[MAX_VESSEL_NAME_LEN];
-    float           lengthFt;
+/*
+ * Struct for each vessel’s information.  The name of a vessel in a fleet
+ * lives in the fleet's name pool, NUL-terminated, next to its lower-cased
+ * copy.  A freshly parsed record only borrows its name from the input:
+ * vesselName then points at nameLen unterminated bytes and foldedName is
+ * NULL until fleetAdd interns it.  Lengths are in hundredths of a foot
+ * and money in cents.  With deferred billing, outstandingFees is the balance
+ * as of fleet month settledEpoch; settleVessel brings it up to date.  A
+ * removed boat stays in the fleet's order as a tombstone until purged.
+ * locPrev and locNext link the boats at the same location.
+ */
+typedef struct Vessel {
+    const char*     vesselName;
+    const char*     foldedName;
+    uint32_t        nameLen;
+    int32_t         lengthHundredths;
     LocationCategory locationCat;
     LocDetails      locationInfo;
-    float           outstandingFees;
+    int64_t         outstandingFees;
+    uint32_t        settledEpoch;
+    uint32_t        removed;
+    struct Vessel*  locPrev;
+    struct Vessel*  locNext;
 } Vessel;
+
+/* A block of vessel names; chunks never move once allocated */
+typedef struct NameChunk {
+    struct NameChunk* next;
+    size_t            used;
+    size_t            capacity;
+    char              text[];
+} NameChunk;
+
+/*
+ * Storage for vessel names.  Each name is stored once, followed by its
+ * case-folded copy for comparisons, packed into chunks, so the pointers
+ * handed out stay valid until the pool is released.  Names of removed
+ * vessels are only reclaimed then, which also lets the autosaver format
+ * its copy of the records without holding the lock.
+ */
+typedef struct {
+    NameChunk* chunks;          /* newest first; only it has spare room */
+} NamePool;
+
+/* A pooled vessel record, or a link in the pool's free list once released */
+typedef union PoolSlot {
+    Vessel           vessel;
+    union PoolSlot*  nextFree;
+} PoolSlot;
+
+/* A block of records carved out of one allocation, handed out in order */
+typedef struct VesselSlab {
+    struct VesselSlab* next;
+    int                used;
+    int                capacity;
+    PoolSlot           slots[];
+} VesselSlab;
+
+/*
+ * Slab allocator for vessel records.  Records are handed out back to back
+ * from slabs that double in size up to POOL_MAX_SLAB; released records go
+ * on a free list for reuse.  Everything is returned slab by slab.
+ */
+typedef struct {
+    VesselSlab* slabs;          /* newest first; only it has spare slots */
+    PoolSlot*   freeList;
+} VesselPool;
+
+/*
+ * The slot layout of a linear-probing table, for the probing, growing and
+ * removal shared by the name and trailer tag indexes.  Tables have a
+ * power-of-two slot count and are kept at most 3/4 full.  Each slot keeps
+ * the low 32 bits of its key's hash at hashOffset, and a zeroed slot is
+ * empty.  matches compares a taken slot against a key.
+ */
+typedef struct {
+    size_t slotSize;
+    size_t hashOffset;
+    int  (*taken)(const void* slot);
+    int  (*matches)(const void* slot, const void* key);
+} ProbeLayout;
+
+/*
+ * One slot of the name index; vessel is NULL when the slot is empty.
+ * copies counts the vessels that carry the name.
+ */
+typedef struct {
+    Vessel*  vessel;
+    uint32_t hash;
+    uint32_t copies;
+} NameSlot;
+
+/*
+ * Hash index from case-folded name to vessel, a linear-probing table as
+ * ProbeLayout describes.  The hash kept in each slot rejects most
+ * mismatches without touching the record.  Each distinct name has one
+ * slot, pointing at one of the vessels that carry it.
+ */
+typedef struct {
+    NameSlot* slots;
+    size_t    mask;             /* slot count - 1 */
+    size_t    count;
+} NameIndex;
+
+/*
+ * B+tree node.  A leaf holds up to TREE_FANOUT vessels in name order and
+ * links to its neighbours.  A branch holds as many children; every name
+ * under children[i] is at least keys[i] and at most keys[i + 1] (keys[0]
+ * is unused).  Keys point into the fleet's name pool, which outlives the
+ * records, so they stay valid after the boat they came from is removed.
+ */
+typedef struct TreeNode {
+    int              leaf;
+    int              count;         /* vessels in a leaf, children in a branch */
+    struct TreeNode* prev;
+    struct TreeNode* next;
+    const char*      keys[TREE_FANOUT];
+    union {
+        Vessel*          vessels[TREE_FANOUT];
+        struct TreeNode* children[TREE_FANOUT];
+    };
+} TreeNode;
+
+/*
+ * The fleet's name order.  Boats of the same name stay in the order they
+ * were added.  spare holds nodes set aside so an insert can split all the
+ * way up without running out of memory halfway.
+ */
+typedef struct {
+    TreeNode* root;
+    TreeNode* first;            /* leftmost leaf */
+    TreeNode* spare;
+    int       height;
+    int       count;
+} VesselTree;
+
+/* A position in the tree's leaves */
+typedef struct {
+    TreeNode* leaf;
+    int       pos;
+} TreeCursor;
+
+/* A walk over the boats whose folded names begin with folded */
+typedef struct {
+    TreeCursor at;
+    char       folded[MAX_INPUT_LEN];
+    size_t     len;
+} PrefixSearch;
+
+/* The boats at one location, in the order they arrived */
+typedef struct {
+    Vessel* head;
+    Vessel* tail;
+    int     count;
+} LocationList;
+
+/* One trailer tag of the tag index; tag is empty when the slot is */
+typedef struct {
+    char         tag[sizeof(((LocDetails*)0)->trailerTag)];
+    uint32_t     hash;
+    LocationList boats;
+} TagSlot;
+
+/*
+ * Which boats are where.  Each slip, storage spot and bay has a list of
+ * the boats at it, and a bit in the matching taken set while the list is
+ * not empty (bit 0 of the slip and storage sets is unused).  Trailer tags,
+ * compared ignoring case, are kept in a linear-probing table as
+ * ProbeLayout describes; a tag's slot is freed when its last boat leaves.
+ * Locations outside the marina's range, and bays that are not letters,
+ * are not indexed.  conflicts counts the slips and storage spots more
+ * than one boat claims.
+ */
+typedef struct {
+    LocationList slips[MAX_SLIP_NUM + 1];
+    LocationList storage[MAX_STORAGE_LOC + 1];
+    LocationList bays[MAX_BAYS];
+    uint64_t     slipsTaken[BITSET_WORDS(MAX_SLIP_NUM + 1)];
+    uint64_t     storageTaken[BITSET_WORDS(MAX_STORAGE_LOC + 1)];
+    uint64_t     baysTaken[BITSET_WORDS(MAX_BAYS)];
+    TagSlot*     tags;
+    size_t       tagMask;           /* slot count - 1 */
+    size_t       tagCount;
+    int          conflicts;
+} LocationIndex;
+
+/*
+ * Every vessel, ordered by name in the B+tree order, which inserts and
+ * removals update in O(log n).  Bulk passes read the same order as the
+ * contiguous pointer array vessels; after interactive changes it is
+ * stale and fleetVessels rebuilds it with one walk over the leaves.  Bulk
+ * loads append to the array, sort it and build the tree from it.  The
+ * array grows geometrically and always has room for every vessel.  The
+ * records themselves come from pool and their names from names; index
+ * finds them by name and locations by where they are kept.  Removed
+ * boats stay in the order as tombstones, counted in count and in
+ * tombstones, until fleetPurge drops them all in one pass.  billingEpoch
+ * counts the months billed; with deferBilling set a month only advances
+ * it and each balance catches up when it is next read.  rejected counts
+ * the data file lines a load could not read.
+ */
+typedef struct {
+    Vessel**      vessels;
+    int           count;
+    int           capacity;
+    int           tombstones;
+    int           vesselsStale;
+    VesselTree    order;
+    VesselPool    pool;
+    NamePool      names;
+    NameIndex     index;
+    LocationIndex locations;
+    uint32_t      billingEpoch;
+    int           deferBilling;
+    long          rejected;
+} Fleet;
+
+/* A field of a CSV record, referenced in place rather than copied */
+typedef struct {
+    const char* start;
+    size_t      len;
+} FieldSlice;
+
+/*
+ * Finds the commas and newlines of a buffer 64 bytes at a time.  mask holds
+ * the not yet consumed structural positions of the block starting at block.
+ */
+typedef struct {
+    const char* data;
+    size_t      len;
+    size_t      pos;            /* start of the next field */
+    size_t      block;
+    uint64_t    mask;
+} StructScanner;
+
+/* Why a record was rejected; insertVessel reports each one differently */
+typedef enum {
+    PARSE_OK,
+    PARSE_BAD_FORMAT,
+    PARSE_INCOMPLETE,
+    PARSE_UNKNOWN_LOCATION,
+    PARSE_MISSING_FEE,
+    PARSE_BAD_NUMBER
+} ParseStatus;
+
+/* On-disk format written on exit, chosen with -f; loads detect it */
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_SNAPSHOT
+} DataFormat;
+
+/* How the fleet is written out */
+typedef struct {
+    DataFormat format;
+    int        workers;         /* threads formatting CSV output */
+} SaveOptions;
+
+/*
+ * Snapshot header.  It is followed by recordCount SnapshotRecords and then
+ * nameBytes of unterminated vessel names.  checksum covers everything
+ * after the header.  Fields are stored in host byte order.
+ */
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t recordCount;
+    uint64_t nameBytes;
+    uint64_t checksum;
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t nameOffset;
+    uint16_t nameLen;
+    uint8_t  locationCat;
+    uint8_t  pad;
+    int32_t  lengthHundredths;
+    int32_t  locNumber;         /* slip or storage spot      */
+    int64_t  outstandingFees;   /* cents                     */
+    char     locText[10];       /* bay label or trailer tag  */
+    char     pad2[6];
+} SnapshotRecord;
+
+/*
+ * Append-only log of the changes made since the data file was last
+ * written.  Its first line, "G,<checksum>", names the data file it
+ * applies to by the checksum of its contents, which serves as the data
+ * file's generation: once the data file has been rewritten, a journal
+ * left behind by a crash no longer matches it and is not replayed again.
+ * fd is -1 when journaling is off.
+ */
+typedef struct {
+    int  fd;
+    long records;           /* entries since the last compaction */
+    long compactEvery;
+    char path[MAX_PATH_LEN];
+} Journal;
+
+/*
+ * Background checkpointing.  The main loop holds lock while a command
+ * uses the fleet, but not while it waits for the operator; the saver
+ * thread takes it only long enough to copy the records into its own
+ * buffer, then formats and writes that copy while the operator carries
+ * on working on the live fleet.
+ */
+typedef struct {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    int             running;
+    int             stopping;
+    int             dirty;          /* fleet changed since the last copy */
+    int             interval;       /* seconds between checkpoints       */
+    const char*     fileName;
+    SaveOptions     options;
+    Fleet*          fleet;
+    Vessel*         copy;
+    Vessel**        copyIndex;
+    int             copyCapacity;
+} AutoSaver;
+
+/*
+ * Output builder.  Records are formatted straight into data; when it fills
+ * up it is handed to sink in one large write.  With no sink it grows
+ * instead, so the whole output can be kept in memory.
+ */
+typedef struct {
+    char*  data;
+    size_t len;
+    size_t cap;
+    FILE*  sink;
+    int    failed;
+} OutBuf;
+
+/* A run of the sorted fleet and the CSV text formatted from it */
+typedef struct {
+    Vessel** vessels;
+    int      count;
+    OutBuf   out;
+} SaveRange;
+
+/* Read-only view of a whole data file (mmap'd where available) */
+typedef struct {
+    const char* data;
+    size_t      size;
+    int         mapped;
+} MappedFile;
+
+/*
+ * Column-wise copy of vessel records for bulk passes.  Billing reads only
+ * monthlyCharge, locationCat and outstandingFees, which sit in dense arrays
+ * of their own, so a pass touches 17 bytes per vessel instead of a whole
+ * record.  monthlyCharge is worked out from the length once, on append.
+ * Location details and names, needed only for output, are kept apart;
+ * names are stored back to back, NUL-terminated, at nameOffset.
+ */
+typedef struct {
+    int32_t*    lengthHundredths;
+    int64_t*    monthlyCharge;
+    uint8_t*    locationCat;
+    int64_t*    outstandingFees;
+    LocDetails* locationInfo;
+    uint32_t*   nameOffset;
+    char*       names;
+    size_t      nameBytes;
+    size_t      nameCapacity;
+    int         count;
+    int         capacity;
+} FleetColumns;
+
+/* What one billing pass charged, per LocationCategory, in whole cents */
+typedef struct {
+    int64_t cents[4];
+    long    vessels[4];
+} BillingTotals;
+
+/*
+ * One partition of a billing pass and what it billed.  Records are billed
+ * through vessels when it is set, otherwise the columns are.
+ */
+typedef struct {
+    Vessel**      vessels;
+    FleetColumns* columns;
+    int           begin;
+    int           end;
+    int           months;
+    BillingTotals totals;
+} BillingRange;
+
+/* A line streaming billing could not parse, to be copied out before record `before` */
+typedef struct {
+    int        before;
+    FieldSlice line;
+} PassedLine;
+
+/* One block of streaming billing: its records in columns and its unparsed lines */
+typedef struct {
+    FleetColumns columns;
+    PassedLine*  passed;
+    int          passedCount;
+    int          passedCapacity;
+} BillBatch;
+
+/*
+ * One newline-aligned slice of the data file and the boats parsed from it.
+ * The chunk's fleet only holds the records; its name index stays empty.
+ * failed is set if the worker ran out of memory part way.  lines counts
+ * the chunk's lines and rejected those that did not parse; the first few
+ * are kept, numbered within the chunk, for the loader to report.
+ */
+typedef struct {
+    const char* begin;
+    const char* end;
+    Fleet       fleet;
+    int         failed;
+    long        lines;
+    long        rejected;
+    long        rejectedAt[MAX_REPORTED_LINES];
+    FieldSlice  rejectedText[MAX_REPORTED_LINES];
+} LoadChunk;
+
 void  printWelcome();
 void  printFarewell();
 void  showMenu();
-void  loadData(const char* fileName, Vessel** fleet, int* totalCount);
-void  saveData(const char* fileName, Vessel** fleet, int totalCount);
-void  listAllVessels(Vessel** fleet, int totalCount);
-void  insertVessel(Vessel** fleet, int* totalCount, const char* csvLine);
-void  removeVessel(Vessel** fleet, int* totalCount);
-void  recordPayment(Vessel** fleet, int totalCount);
-void  applyMonthlyFees(Vessel** fleet, int totalCount);
+int   readInput(const char* prompt, char* buf, size_t size);
+void  poolInit(VesselPool* pool);
+Vessel* poolAlloc(VesselPool* pool);
+void  poolFree(VesselPool* pool, Vessel* boat);
+void  poolSplice(VesselPool* into, VesselPool* from);
+void  poolRelease(VesselPool* pool);
+void  namePoolInit(NamePool* pool);
+const char* namePoolAdd(NamePool* pool, const char* name, size_t len, const char** folded);
+void  namePoolSplice(NamePool* into, NamePool* from);
+void  namePoolRelease(NamePool* pool);
+void  foldName(char* folded, const char* name, size_t len);
+uint64_t hashName(const char* folded, size_t len);
+void  nameIndexInit(NameIndex* index);
+int   nameIndexReserve(NameIndex* index, size_t count);
+int   nameIndexAdd(NameIndex* index, Vessel* boat);
+void  nameIndexRemove(NameIndex* index, const Vessel* boat, const VesselTree* order);
+Vessel* nameIndexFind(const NameIndex* index, const char* folded, size_t len);
+void  nameIndexFree(NameIndex* index);
+void  locationIndexInit(LocationIndex* loc);
+int   locationIndexAdd(LocationIndex* loc, Vessel* boat);
+void  locationIndexRemove(LocationIndex* loc, Vessel* boat);
+int   locationIndexBuild(LocationIndex* loc, Vessel** vessels, int count);
+const LocationList* locationIndexFind(const LocationIndex* loc, LocationCategory cat,
+                                      const LocDetails* where);
+int   locationIndexFirstFree(const LocationIndex* loc, LocationCategory cat);
+void  locationIndexFree(LocationIndex* loc);
+void  treeInit(VesselTree* tree);
+int   treeBuild(VesselTree* tree, Vessel** sorted, int count);
+int   treeInsert(VesselTree* tree, Vessel* boat);
+int   treeRemove(VesselTree* tree, const Vessel* boat);
+Vessel* treeFind(const VesselTree* tree, const char* folded);
+void  treeSeek(const VesselTree* tree, const char* folded, TreeCursor* at);
+Vessel* treeNext(TreeCursor* at);
+void  treeFree(VesselTree* tree);
+void  fleetInit(Fleet* fleet);
+int   fleetReserve(Fleet* fleet, int capacity);
+int   fleetAppend(Fleet* fleet, Vessel* boat);
+Vessel* fleetAdd(Fleet* fleet, const Vessel* boat);
+int   fleetBuildOrder(Fleet* fleet);
+Vessel** fleetVessels(Fleet* fleet);
+Vessel** fleetLiveVessels(Fleet* fleet);
+Vessel* fleetInsert(Fleet* fleet, const Vessel* boat);
+void  fleetRemove(Fleet* fleet, Vessel* boat);
+void  fleetPurge(Fleet* fleet);
+int   loadData(const char* fileName, Fleet* fleet);
+int   saveData(const char* fileName, Vessel** fleet, int totalCount, int workers);
+void  listAllVessels(Fleet* fleet);
+void  searchVessels(Fleet* fleet, const char* prefix);
+void  prefixSearchStart(const Fleet* fleet, const char* prefix, PrefixSearch* search);
+Vessel* prefixSearchNext(PrefixSearch* search);
+void  reportNoSuchBoat(const Fleet* fleet, const char* name);
+void  locateVessels(Fleet* fleet, const char* query);
+void  showOccupancy(const Fleet* fleet);
+void  insertVessel(Fleet* fleet, const char* csvLine, Journal* journal);
+Vessel* addVesselFromCsv(Fleet* fleet, const char* csvLine);
+void  removeVessel(Fleet* fleet, const char* name, Journal* journal);
+void  recordPayment(Fleet* fleet, const char* name, const char* amountText, Journal* journal);
+void  applyMonthlyFees(Fleet* fleet, int workers, Journal* journal);
+void  chargeMonthlyFees(Fleet* fleet, int workers, BillingTotals* totals);
+void  accrueMonth(Fleet* fleet, int workers);
+void  settleVessel(const Fleet* fleet, Vessel* v);
+void  settleFleet(Fleet* fleet);
+int64_t monthlyChargeFor(const Vessel* v);
+void  columnsInit(FleetColumns* cols);
+int   columnsReserve(FleetColumns* cols, int capacity);
+int   columnsAppend(FleetColumns* cols, const Vessel* boat);
+void  columnsGet(const FleetColumns* cols, int idx, Vessel* boat);
+const char* columnsName(const FleetColumns* cols, int idx);
+void  columnsClear(FleetColumns* cols);
+void  columnsFree(FleetColumns* cols);
+int   columnsFromFleet(FleetColumns* cols, Fleet* fleet);
+void  chargeColumns(FleetColumns* cols, int months, int workers, BillingTotals* totals);
+void  billPartitioned(BillingRange* whole, int workers, BillingTotals* totals);
+void  formatVesselRecord(OutBuf* ob, const Vessel* v);
+void  formatInventoryLine(OutBuf* ob, const Vessel* v);
+int   saveRangesParallel(FILE* fp, Vessel** fleet, int totalCount, int workers);
+int   outInit(OutBuf* ob, FILE* sink);
+void  outFlush(OutBuf* ob);
+int   outFinish(OutBuf* ob);
+void  outBytes(OutBuf* ob, const char* bytes, size_t len);
+void  outPadded(OutBuf* ob, const char* str, int width);
+void  outInt(OutBuf* ob, long value, int width);
+void  outCents(OutBuf* ob, int64_t cents, int width);
+void  outFeet(OutBuf* ob, int32_t hundredths, int width);
+long  billStream(const char* inFile, const char* outFile, int months, int workers,
+                 long* passedThrough, BillingTotals* totals);
 char* locationCategoryToStr(LocationCategory lc);
-int   locateVesselByName(Vessel** fleet, int totalCount, const char* searchName);
+Vessel* findVesselByName(const Fleet* fleet, const char* searchName);
 int   compareVessels(const void* a, const void* b);
-void  freeVesselMemory(Vessel** fleet, int totalCount);
+void  freeVesselMemory(Fleet* fleet);
+int   loadDataMapped(const char* fileName, Fleet* fleet);
+int   loadFleetBuffer(Fleet* fleet, const char* data, size_t len);
+int   parseVesselRecord(const char* line, size_t len, Vessel* boat);
+void  reportRejectedLine(Fleet* fleet, long lineNo, FieldSlice line);
+void  scannerInit(StructScanner* sc, const char* data, size_t len);
+size_t scannerNext(StructScanner* sc);
+int   scanRecord(StructScanner* sc, FieldSlice* fields, int maxFields);
+ParseStatus decodeVesselFields(const FieldSlice* field, int count, Vessel* boat, int ignoreCase);
+ParseStatus decodeLocationFields(const FieldSlice* field, int count, LocationCategory* cat,
+                                 LocDetails* where, int ignoreCase);
+void  initScanKernel();
+void  initBillingKernel();
+int   parseWholeNumber(FieldSlice field, int* value);
+int   parseFixed(FieldSlice field, int places, int64_t* value);
+int   parseMoney(FieldSlice field, int64_t* cents);
+int   mapDataFile(const char* fileName, MappedFile* mf);
+void  unmapDataFile(MappedFile* mf);
+int   loadDataParallel(const char* fileName, Fleet* fleet, int workers);
+void  runWorkers(int workers, void* (*task)(void*), void* args, size_t argSize);
+double nowSeconds();
+void  reportThroughput(const char* action, const char* fileName, int count, double seconds);
+void  printUsage(const char* progName);
+void  printBillingTotals(const BillingTotals* totals);
+int   loadSnapshot(const char* fileName, Fleet* fleet);
+int   isSnapshotFile(const char* fileName);
+int   saveSnapshot(const char* fileName, Vessel** fleet, int totalCount);
+int   saveFleetFile(const char* fileName, SaveOptions options, Vessel** fleet, int totalCount);
+int   saveFleetAtomic(const char* fileName, SaveOptions options, Vessel** fleet, int totalCount);
+void  autoSaverInit(AutoSaver* saver);
+int   autoSaverStart(AutoSaver* saver, const char* fileName, SaveOptions options,
+                     Fleet* fleet, int interval);
+void  autoSaverStop(AutoSaver* saver);
+int   journalOpen(Journal* journal, const char* dataFile, long compactEvery);
+int   journalStamp(Journal* journal, const char* dataFile);
+int   dataFileChecksum(const char* fileName, uint64_t* sum);
+void  journalClose(Journal* journal);
+void  journalRecord(Journal* journal, const char* format, ...);
+long  replayJournal(const char* dataFile, Fleet* fleet);
+int   compactJournal(Journal* journal, const char* dataFile, SaveOptions options,
+                     Vessel** fleet, int totalCount);
+uint64_t snapshotChecksum(const void* data, size_t len);
+void  runBenchmark(const char* name, long rows, int workers);
+char* generateSyntheticFleet(long rows, size_t* outLen);
+uint64_t readCycles();
 
 int main(int argc, char* argv[])
 {
-    Vessel* fleet[MAX_VESSELS] = { NULL };
-    int     totalVessels       = 0;
-    char    userChoice;
-    char    inputBuffer[256];
-    if (argc != 2) {
-        printf("Usage: %s <boatdata.csv>\n", argv[0]);
+    Fleet       fleet;
+    char        userChoice;
+    char        inputBuffer[MAX_INPUT_LEN];
+    int         useMapped    = 0;
+    int         reportTiming = 0;
+    int         deferBilling = 0;
+    int         workers      = 1;
+    DataFormat  format       = FORMAT_CSV;
+    int         useJournal   = 0;
+    long        compactEvery = JOURNAL_COMPACT_DEFAULT;
+    Journal     journal      = { -1, 0, 0, "" };
+    int         autosaveSecs = 0;
+    AutoSaver   saver;
+    const char* billOutput   = NULL;
+    int         billMonths   = 1;
+    const char* benchName    = NULL;
+    long        benchRows    = BENCH_DEFAULT_ROWS;
+    int         opt;
+
+    initScanKernel();
+    initBillingKernel();
+    fleetInit(&fleet);
+
+    while ((opt = getopt(argc, argv, "mtlj:f:wc:a:b:k:B:n:")) != -1) {
+        switch (opt) {
+            case 'm':
+                useMapped = 1;
+                break;
+            case 'j':
+                workers = atoi(optarg);
+                if (workers < 1 || workers > MAX_WORKERS) {
+                    printf("Error: thread count must be between 1 and %d.\n", MAX_WORKERS);
+                    return 1;
+                }
+                break;
+            case 't':
+                reportTiming = 1;
+                break;
+            case 'l':
+                deferBilling = 1;
+                break;
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) {
+                    format = FORMAT_CSV;
+                } else if (strcmp(optarg, "snap") == 0) {
+                    format = FORMAT_SNAPSHOT;
+                } else {
+                    printf("Error: unknown format %s (use csv or snap).\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                useJournal = 1;
+                break;
+            case 'c':
+                compactEvery = atol(optarg);
+                if (compactEvery < 1) {
+                    printf("Error: compaction interval must be positive.\n");
+                    return 1;
+                }
+                break;
+            case 'a':
+                autosaveSecs = atoi(optarg);
+                if (autosaveSecs < 1) {
+                    printf("Error: autosave interval must be at least one second.\n");
+                    return 1;
+                }
+                break;
+            case 'b':
+                billOutput = optarg;
+                break;
+            case 'k':
+                billMonths = atoi(optarg);
+                if (billMonths < 1) {
+                    printf("Error: month count must be positive.\n");
+                    return 1;
+                }
+                break;
+            case 'B':
+                benchName = optarg;
+                break;
+            case 'n':
+                benchRows = atol(optarg);
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (benchName) {
+        runBenchmark(benchName, benchRows, workers);
+        return 0;
+    }
+    if (optind != argc - 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (useJournal && autosaveSecs > 0) {
+        printf("Error: -a and -w cannot be combined; the journal already saves every change.\n");
+        return 1;
+    }
+    const char* dataFile    = argv[optind];
+    SaveOptions saveOptions = { format, workers };
+
+    /* Non-interactive month-end run */
+    if (billOutput) {
+        long          passed = 0;
+        BillingTotals totals;
+        double        begun  = nowSeconds();
+        long          billed = billStream(dataFile, billOutput, billMonths, workers,
+                                          &passed, &totals);
+        if (billed < 0) {
+            return 1;
+        }
+        printf("Billed %ld vessels for %d month(s); %ld unparsed lines copied unchanged.\n",
+               billed, billMonths, passed);
+        printBillingTotals(&totals);
+        if (reportTiming) {
+            reportThroughput("Billed", dataFile, (int)billed, nowSeconds() - begun);
+        }
+        return 0;
+    }
+
+    /* data from CSV or snapshot */
+    fleet.deferBilling = deferBilling;
+    double started = nowSeconds();
+    int loaded;
+    if (isSnapshotFile(dataFile)) {
+        loaded = loadSnapshot(dataFile, &fleet);
+    } else if (workers > 1) {
+        loaded = loadDataParallel(dataFile, &fleet, workers);
+    } else if (useMapped) {
+        loaded = loadDataMapped(dataFile, &fleet);
+    } else {
+        loaded = loadData(dataFile, &fleet);
+    }
+    if (loaded != 0) {
+        printf("Error: %s could not be loaded; refusing to overwrite it.\n", dataFile);
+        freeVesselMemory(&fleet);
         return 1;
     }
+    if (reportTiming) {
+        reportThroughput("Loaded", dataFile, fleet.count, nowSeconds() - started);
+    }
+
+    /* Saving over a file some of whose lines could not be read would drop them */
+    const char* saveFile = dataFile;
+    char        partialFile[MAX_PATH_LEN];
+    if (fleet.rejected > 0) {
+        if (useJournal) {
+            printf("Error: %ld line(s) of %s could not be read; fix them before journaling to it.\n",
+                   fleet.rejected, dataFile);
+            freeVesselMemory(&fleet);
+            return 1;
+        }
+        snprintf(partialFile, sizeof(partialFile), "%s%s", dataFile, PARTIAL_SUFFIX);
+        saveFile = partialFile;
+        printf("Warning: %ld line(s) of %s could not be read, so it will not be overwritten;\n"
+               "         this session saves to %s instead.\n", fleet.rejected, dataFile, saveFile);
+    }
+
+    /* Changes a previous session journaled but never compacted */
+    long replayed = replayJournal(dataFile, &fleet);
+    if (useJournal && journalOpen(&journal, dataFile, compactEvery) != 0) {
+        printf("Error: Could not open journal %s%s.\n", dataFile, JOURNAL_SUFFIX);
+        freeVesselMemory(&fleet);
+        return 1;
+    }
+    journal.records = replayed;
+    if (fleet.locations.conflicts > 0) {
+        printf("Warning: %d slips or storage spots are claimed by more than one boat;\n"
+               "         (O)ccupancy lists them.\n", fleet.locations.conflicts);
+    }
 
-    /* data from CSV */
-    loadData(argv[1], fleet, &totalVessels);
+    autoSaverInit(&saver);
+    if (autosaveSecs > 0) {
+        /* Checkpoints must not be replayed over, so fold the journal in now */
+        settleFleet(&fleet);
+        fleetPurge(&fleet);
+        if (replayed > 0 && saveFile == dataFile &&
+            saveFleetAtomic(dataFile, saveOptions, fleetVessels(&fleet), fleet.count) == 0) {
+            char path[MAX_PATH_LEN];
+            snprintf(path, sizeof(path), "%s%s", dataFile, JOURNAL_SUFFIX);
+            unlink(path);
+            replayed = 0;
+        }
+        if (autoSaverStart(&saver, saveFile, saveOptions, &fleet, autosaveSecs) != 0) {
+            printf("Warning: Could not start autosave; saving on exit only.\n");
+        }
+    }
 
     /* Welcome message */
     printWelcome();
@@ -88,27 +857,71 @@ int main(int argc, char* argv[])
     do {
         showMenu();
         if (fgets(inputBuffer, sizeof(inputBuffer), stdin) != NULL) {
+            char argument[MAX_INPUT_LEN];
+            char amount[MAX_INPUT_LEN];
+            int  ready = 1;
             userChoice = toupper(inputBuffer[0]);
 
+            /* Prompts are answered before the lock is taken, so checkpoints never wait on them */
             switch (userChoice) {
+                case 'A':
+                    ready = readInput("Please enter the boat data in CSV format                 : ",
+                                      argument, sizeof(argument));
+                    break;
+                case 'R':
+                    ready = readInput("Please enter the boat name                               : ",
+                                      argument, sizeof(argument));
+                    break;
+                case 'P':
+                    ready = readInput("Please enter the boat name: ", argument, sizeof(argument));
+                    if (ready) {
+                        pthread_mutex_lock(&saver.lock);
+                        if (!findVesselByName(&fleet, argument)) {
+                            reportNoSuchBoat(&fleet, argument);
+                            ready = 0;
+                        }
+                        pthread_mutex_unlock(&saver.lock);
+                    }
+                    ready = ready && readInput("Please enter the amount to be paid: ",
+                                               amount, sizeof(amount));
+                    break;
+                case 'S':
+                    ready = readInput("Please enter the start of the boat name                  : ",
+                                      argument, sizeof(argument));
+                    break;
+                case 'L':
+                    ready = readInput("Please enter the location, e.g. slip,42 or land,C        : ",
+                                      argument, sizeof(argument));
+                    break;
+            }
+
+            pthread_mutex_lock(&saver.lock);
+            switch (ready ? userChoice : '\0') {
+                case '\0':
+                    break;
                 case 'I':
-                    listAllVessels(fleet, totalVessels);
+                    listAllVessels(&fleet);
                     break;
                 case 'A':
-                    printf("Please enter the boat data in CSV format                 : ");
-                    if (fgets(inputBuffer, sizeof(inputBuffer), stdin) != NULL) {
-                        inputBuffer[strcspn(inputBuffer, "\n")] = '\0';
-                        insertVessel(fleet, &totalVessels, inputBuffer);
-                    }
+                    insertVessel(&fleet, argument, &journal);
                     break;
                 case 'R':
-                    removeVessel(fleet, &totalVessels);
+                    removeVessel(&fleet, argument, &journal);
                     break;
                 case 'P':
-                    recordPayment(fleet, totalVessels);
+                    recordPayment(&fleet, argument, amount, &journal);
                     break;
                 case 'M':
-                    applyMonthlyFees(fleet, totalVessels);
+                    applyMonthlyFees(&fleet, workers, &journal);
+                    break;
+                case 'S':
+                    searchVessels(&fleet, argument);
+                    break;
+                case 'L':
+                    locateVessels(&fleet, argument);
+                    break;
+                case 'O':
+                    showOccupancy(&fleet);
                     break;
                 case 'X':
                     break;
@@ -116,428 +929,5244 @@ int main(int argc, char* argv[])
                     printf("Invalid option %c\n\n", userChoice);
                     break;
             }
+            if (ready && userChoice && strchr("ARPM", userChoice)) {
+                saver.dirty = 1;
+            }
+            pthread_mutex_unlock(&saver.lock);
+
+            if (journal.fd >= 0 && journal.records >= journal.compactEvery) {
+                settleFleet(&fleet);
+                fleetPurge(&fleet);
+                compactJournal(&journal, dataFile, saveOptions, fleetVessels(&fleet), fleet.count);
+            }
+        }
+    } while (userChoice != 'X');
+
+    /*
+     * With a journal every change is already on disk, so the data file is
+     * only rewritten once enough entries have built up.  Without one, save
+     * as usual and drop any journal that was replayed at startup.  The
+     * autosaver gets a final flush unless its last checkpoint is current.
+     * It is stopped before the fleet is settled and purged, as it settles
+     * and purges the fleet itself.
+     */
+    started = nowSeconds();
+    int autosaved = saver.running;
+    autoSaverStop(&saver);
+    settleFleet(&fleet);
+    fleetPurge(&fleet);
+    if (autosaved) {
+        if (saver.dirty) {
+            saveFleetAtomic(saveFile, saveOptions, fleetVessels(&fleet), fleet.count);
+        }
+        if (reportTiming) {
+            reportThroughput("Saved", saveFile, fleet.count, nowSeconds() - started);
+        }
+    } else if (journal.fd >= 0) {
+        if (journal.records >= journal.compactEvery &&
+            compactJournal(&journal, dataFile, saveOptions, fleetVessels(&fleet),
+                           fleet.count) == 0 &&
+            reportTiming) {
+            reportThroughput("Saved", dataFile, fleet.count, nowSeconds() - started);
+        }
+        journalClose(&journal);
+    } else {
+        if (saveFleetFile(saveFile, saveOptions, fleetVessels(&fleet), fleet.count) == 0 &&
+            replayed > 0 && saveFile == dataFile) {
+            char path[MAX_PATH_LEN];
+            snprintf(path, sizeof(path), "%s%s", dataFile, JOURNAL_SUFFIX);
+            unlink(path);
+        }
+        if (reportTiming) {
+            reportThroughput("Saved", saveFile, fleet.count, nowSeconds() - started);
+        }
+    }
+
+    printFarewell();
+
+    /* Free memory */
+    freeVesselMemory(&fleet);
+
+    return 0;
+}
+/*
+ * Show a prompt and read the operator's answer, without its newline.
+ * Returns 0 at the end of input.
+ */
+int readInput(const char* prompt, char* buf, size_t size)
+{
+    printf("%s", prompt);
+    if (fgets(buf, (int)size, stdin) == NULL) {
+        return 0;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 1;
+}
+
+void printUsage(const char* progName)
+{
+    printf("Usage: %s [-m] [-t] [-l] [-j threads] [-f csv|snap] [-w [-c entries] | -a seconds]\n"
+           "       <boatdata.csv>\n", progName);
+    printf("       %s -b billed.csv [-k months] [-t] <boatdata.csv>\n", progName);
+    printf("       %s -B benchmark [-n rows]\n", progName);
+    printf("  -m  load the data file through a memory map (zero-copy parser)\n");
+    printf("  -t  report load/save time and throughput\n");
+    printf("  -l  defer monthly charges; each balance catches up when it is next read\n");
+    printf("  -j  parse, bill and save the data file on this many threads (implies -m)\n");
+    printf("  -f  format to save in: csv (default) or snap (binary snapshot);\n");
+    printf("      either format is recognised when loading\n");
+    printf("  -w  journal each change to <boatdata.csv>%s instead of rewriting\n", JOURNAL_SUFFIX);
+    printf("      the data file on exit\n");
+    printf("  -c  with -w, rewrite the data file after this many entries (default %d)\n",
+           JOURNAL_COMPACT_DEFAULT);
+    printf("  -a  save a checkpoint in the background every this many seconds\n");
+    printf("  -b  stream the data file through month-end billing into this file\n");
+    printf("  -k  with -b, number of months to bill (default 1)\n");
+    printf("  -B  run a benchmark on synthetic data instead (scan, numparse, fleet,\n");
+    printf("      alloc, billing, accrual, lookup, insert, remove, prefix, locate,\n");
+    printf("      allocate)\n");
+    printf("  -n  number of synthetic rows for -B (default %d)\n", BENCH_DEFAULT_ROWS);
+}
+
+/* Write cents as dollars, e.g. -1234 as "-12.34" */
+static const char* centsText(char* buf, size_t size, int64_t cents)
+{
+    uint64_t magnitude = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+    snprintf(buf, size, "%s%" PRIu64 ".%02d", cents < 0 ? "-" : "", magnitude / 100,
+             (int)(magnitude % 100));
+    return buf;
+}
+
+/* Print cents as dollars, e.g. -1234 as -$12.34 */
+static void printCents(int64_t cents)
+{
+    char text[32];
+    centsText(text, sizeof(text), cents);
+    printf("%s$%s", cents < 0 ? "-" : "", text + (cents < 0));
+}
+
+/*
+ * Print what a billing run charged, category by category
+ */
+void printBillingTotals(const BillingTotals* totals)
+{
+    int64_t allCents   = 0;
+    long    allVessels = 0;
+    for (int cat = SLIP; cat <= STORAGE; cat++) {
+        printf("  %-8s %10ld vessels  ", locationCategoryToStr((LocationCategory)cat),
+               totals->vessels[cat]);
+        printCents(totals->cents[cat]);
+        printf("\n");
+        allCents   += totals->cents[cat];
+        allVessels += totals->vessels[cat];
+    }
+    printf("  %-8s %10ld vessels  ", "total", allVessels);
+    printCents(allCents);
+    printf("\n");
+}
+
+void printWelcome()
+{
+    printf("\nWelcome to Alans' Boat Management\n");
+    printf("--------------------------------------------\n\n");
+}
+
+void printFarewell()
+{
+    printf("\nExiting Boat Management System\n");
+}
+
+void showMenu()
+{
+    printf("(I)nventory, (A)dd, (R)emove, (P)ayment, (M)onth, (S)earch, (L)ocate, (O)ccupancy, "
+           "e(X)it : ");
+}
+
+void poolInit(VesselPool* pool)
+{
+    pool->slabs    = NULL;
+    pool->freeList = NULL;
+}
+
+/*
+ * Hand out a record, reusing a released one first.  Returns NULL when out
+ * of memory.
+ */
+Vessel* poolAlloc(VesselPool* pool)
+{
+    if (pool->freeList) {
+        PoolSlot* slot = pool->freeList;
+        pool->freeList = slot->nextFree;
+        return &slot->vessel;
+    }
+
+    VesselSlab* slab = pool->slabs;
+    if (!slab || slab->used == slab->capacity) {
+        int capacity = POOL_MIN_SLAB;
+        if (slab) {
+            capacity = slab->capacity < POOL_MAX_SLAB ? slab->capacity * 2 : POOL_MAX_SLAB;
+        }
+        slab = (VesselSlab*)malloc(sizeof(VesselSlab) + (size_t)capacity * sizeof(PoolSlot));
+        if (!slab) {
+            return NULL;
+        }
+        slab->next     = pool->slabs;
+        slab->used     = 0;
+        slab->capacity = capacity;
+        pool->slabs    = slab;
+    }
+    return &slab->slots[slab->used++].vessel;
+}
+
+/*
+ * Put a record back for the next poolAlloc
+ */
+void poolFree(VesselPool* pool, Vessel* boat)
+{
+    PoolSlot* slot = (PoolSlot*)boat;
+    slot->nextFree = pool->freeList;
+    pool->freeList = slot;
+}
+
+/*
+ * Move every slab and free record of from into into, leaving from empty.
+ * The slabs go behind into's own so its current slab keeps filling up.
+ */
+void poolSplice(VesselPool* into, VesselPool* from)
+{
+    VesselSlab** slabTail = &into->slabs;
+    while (*slabTail) {
+        slabTail = &(*slabTail)->next;
+    }
+    *slabTail = from->slabs;
+
+    PoolSlot** freeTail = &into->freeList;
+    while (*freeTail) {
+        freeTail = &(*freeTail)->nextFree;
+    }
+    *freeTail = from->freeList;
+
+    poolInit(from);
+}
+
+/*
+ * Free every record of the pool at once
+ */
+void poolRelease(VesselPool* pool)
+{
+    while (pool->slabs) {
+        VesselSlab* next = pool->slabs->next;
+        free(pool->slabs);
+        pool->slabs = next;
+    }
+    pool->freeList = NULL;
+}
+
+void namePoolInit(NamePool* pool)
+{
+    pool->chunks = NULL;
+}
+
+/*
+ * Write the lower-cased copy of name[0, len) used for comparisons, and
+ * terminate it
+ */
+void foldName(char* folded, const char* name, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        folded[i] = (char)tolower((unsigned char)name[i]);
+    }
+    folded[len] = '\0';
+}
+
+/*
+ * Store name[0, len) and its folded copy.  Returns the stored name, or
+ * NULL when out of memory.
+ */
+const char* namePoolAdd(NamePool* pool, const char* name, size_t len, const char** folded)
+{
+    size_t     need  = 2 * (len + 1);
+    NameChunk* chunk = pool->chunks;
+
+    if (!chunk || chunk->capacity - chunk->used < need) {
+        size_t capacity = need > NAME_CHUNK_SIZE ? need : NAME_CHUNK_SIZE;
+        chunk = (NameChunk*)malloc(sizeof(NameChunk) + capacity);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next     = pool->chunks;
+        chunk->used     = 0;
+        chunk->capacity = capacity;
+        pool->chunks    = chunk;
+    }
+
+    char* stored = chunk->text + chunk->used;
+    memcpy(stored, name, len);
+    stored[len] = '\0';
+    foldName(stored + len + 1, name, len);
+    chunk->used += need;
+    *folded = stored + len + 1;
+    return stored;
+}
+
+/* Move every chunk of from into into, behind into's own */
+void namePoolSplice(NamePool* into, NamePool* from)
+{
+    NameChunk** tail = &into->chunks;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = from->chunks;
+    namePoolInit(from);
+}
+
+void namePoolRelease(NamePool* pool)
+{
+    while (pool->chunks) {
+        NameChunk* next = pool->chunks->next;
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+}
+
+/* FNV-1a over a folded name, with the high bits mixed into the low */
+uint64_t hashName(const char* folded, size_t len)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)folded[i]) * 0x100000001B3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+void nameIndexInit(NameIndex* index)
+{
+    index->slots = NULL;
+    index->mask  = 0;
+    index->count = 0;
+}
+
+static uint32_t probeSlotHash(const ProbeLayout* layout, const char* slot)
+{
+    uint32_t hash;
+    memcpy(&hash, slot + layout->hashOffset, sizeof(hash));
+    return hash;
+}
+
+/*
+ * The slot matching key, or the empty slot that ends its probe run
+ */
+static inline void* probeFind(const ProbeLayout* layout, void* slots, size_t mask,
+                              const void* key, uint64_t hash)
+{
+    size_t pos = hash & mask;
+    for (;;) {
+        char* slot = (char*)slots + pos * layout->slotSize;
+        if (!layout->taken(slot) ||
+            (probeSlotHash(layout, slot) == (uint32_t)hash && layout->matches(slot, key))) {
+            return slot;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+/*
+ * Make room for count keys in *slots, doubling from minSlots and
+ * rehashing as needed.  Returns -1 when out of memory, leaving the table
+ * as it was.
+ */
+static int probeReserve(const ProbeLayout* layout, void** slots, size_t* mask, size_t count,
+                        size_t minSlots)
+{
+    size_t capacity = *slots ? *mask + 1 : 0;
+    if (count <= capacity / 4 * 3) {
+        return 0;
+    }
+
+    size_t newCap = capacity ? capacity * 2 : minSlots;
+    while (count > newCap / 4 * 3) {
+        newCap *= 2;
+    }
+    char* fresh = (char*)calloc(newCap, layout->slotSize);
+    if (!fresh) {
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        const char* old = (const char*)*slots + i * layout->slotSize;
+        if (layout->taken(old)) {
+            size_t pos = probeSlotHash(layout, old) & (newCap - 1);
+            while (layout->taken(fresh + pos * layout->slotSize)) {
+                pos = (pos + 1) & (newCap - 1);
+            }
+            memcpy(fresh + pos * layout->slotSize, old, layout->slotSize);
+        }
+    }
+    free(*slots);
+    *slots = fresh;
+    *mask  = newCap - 1;
+    return 0;
+}
+
+/*
+ * Empty a slot, moving the later entries of its probe run back over the
+ * hole so that the table needs no tombstones
+ */
+static void probeDelete(const ProbeLayout* layout, void* slots, size_t mask, void* slot)
+{
+    char*  base = (char*)slots;
+    size_t size = layout->slotSize;
+    size_t hole = (size_t)((char*)slot - base) / size;
+    size_t next = (hole + 1) & mask;
+    while (layout->taken(base + next * size)) {
+        /* An entry may fill the hole if its home slot is not after it */
+        size_t home = probeSlotHash(layout, base + next * size) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            memcpy(base + hole * size, base + next * size, size);
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    memset(base + hole * size, 0, size);
+}
+
+static int nameSlotTaken(const void* slot)
+{
+    return ((const NameSlot*)slot)->vessel != NULL;
+}
+
+/* key is a FieldSlice holding an already folded name */
+static int nameSlotMatches(const void* slot, const void* key)
+{
+    const Vessel*     boat = ((const NameSlot*)slot)->vessel;
+    const FieldSlice* name = (const FieldSlice*)key;
+    return boat->nameLen == name->len && memcmp(boat->foldedName, name->start, name->len) == 0;
+}
+
+static const ProbeLayout nameSlotLayout = {
+    sizeof(NameSlot), offsetof(NameSlot, hash), nameSlotTaken, nameSlotMatches
+};
+
+/*
+ * The slot holding folded, or the empty slot that ends its probe run
+ */
+static NameSlot* nameIndexProbe(const NameIndex* index, const char* folded, size_t len,
+                                uint64_t hash)
+{
+    FieldSlice key = { folded, len };
+    return (NameSlot*)probeFind(&nameSlotLayout, index->slots, index->mask, &key, hash);
+}
+
+/*
+ * Make room for count names.  Returns -1 when out of memory, leaving the
+ * index as it was.
+ */
+int nameIndexReserve(NameIndex* index, size_t count)
+{
+    void* slots = index->slots;
+    if (probeReserve(&nameSlotLayout, &slots, &index->mask, count, NAME_INDEX_MIN_SLOTS) != 0) {
+        return -1;
+    }
+    index->slots = (NameSlot*)slots;
+    return 0;
+}
+
+/*
+ * Index a vessel under its folded name.  If another vessel already stands
+ * for that name it only adds to the count.  Returns -1 when out of memory.
+ */
+int nameIndexAdd(NameIndex* index, Vessel* boat)
+{
+    if (nameIndexReserve(index, index->count + 1) != 0) {
+        return -1;
+    }
+    uint64_t  hash = hashName(boat->foldedName, boat->nameLen);
+    NameSlot* slot = nameIndexProbe(index, boat->foldedName, boat->nameLen, hash);
+    if (!slot->vessel) {
+        slot->vessel = boat;
+        slot->hash   = (uint32_t)hash;
+        slot->copies = 0;
+        index->count++;
+    }
+    slot->copies++;
+    return 0;
+}
+
+/*
+ * Drop a vessel that is leaving the fleet, which order must no longer
+ * find.  While other vessels carry its name the first of them in order
+ * stands for it; otherwise the later entries of its probe run move back
+ * over the hole.
+ */
+void nameIndexRemove(NameIndex* index, const Vessel* boat, const VesselTree* order)
+{
+    if (!index->slots) {
+        return;
+    }
+    uint64_t  hash = hashName(boat->foldedName, boat->nameLen);
+    NameSlot* slot = nameIndexProbe(index, boat->foldedName, boat->nameLen, hash);
+    if (!slot->vessel) {
+        return;
+    }
+    if (--slot->copies > 0) {
+        if (slot->vessel == boat) {
+            slot->vessel = treeFind(order, boat->foldedName);
+        }
+        return;
+    }
+    probeDelete(&nameSlotLayout, index->slots, index->mask, slot);
+    index->count--;
+}
+
+/*
+ * The vessel standing for an already folded name, or NULL
+ */
+Vessel* nameIndexFind(const NameIndex* index, const char* folded, size_t len)
+{
+    if (!index->slots) {
+        return NULL;
+    }
+    return nameIndexProbe(index, folded, len, hashName(folded, len))->vessel;
+}
+
+void nameIndexFree(NameIndex* index)
+{
+    free(index->slots);
+    nameIndexInit(index);
+}
+
+#if defined(__GNUC__)
+#define countTrailingZeros(word) __builtin_ctzll(word)
+#else
+static int countTrailingZeros(uint64_t word)
+{
+    int n = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+}
+#endif
+
+static void bitSet(uint64_t* bits, int bit)
+{
+    bits[bit / 64] |= 1ULL << (bit % 64);
+}
+
+static void bitClear(uint64_t* bits, int bit)
+{
+    bits[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+static int bitTest(const uint64_t* bits, int bit)
+{
+    return (int)((bits[bit / 64] >> (bit % 64)) & 1);
+}
+
+void locationIndexInit(LocationIndex* loc)
+{
+    memset(loc, 0, sizeof(*loc));
+}
+
+/* Slips and storage spots hold one boat each; bays and trailers need not */
+static int locationIsExclusive(LocationCategory cat)
+{
+    return cat == SLIP || cat == STORAGE;
+}
+
+/* Bay A-Z as 0-25, in either case, or -1 */
+static int bayNumber(char label)
+{
+    int c = toupper((unsigned char)label);
+    return c >= 'A' && c <= 'Z' ? c - 'A' : -1;
+}
+
+static int tagSlotTaken(const void* slot)
+{
+    return ((const TagSlot*)slot)->tag[0] != '\0';
+}
+
+/* key is an already folded tag */
+static int tagSlotMatches(const void* slot, const void* key)
+{
+    return strcmp(((const TagSlot*)slot)->tag, (const char*)key) == 0;
+}
+
+static const ProbeLayout tagSlotLayout = {
+    sizeof(TagSlot), offsetof(TagSlot, hash), tagSlotTaken, tagSlotMatches
+};
+
+/*
+ * The slot holding an already folded tag, or the empty slot that ends its
+ * probe run
+ */
+static TagSlot* tagIndexProbe(const LocationIndex* loc, const char* folded, uint64_t hash)
+{
+    return (TagSlot*)probeFind(&tagSlotLayout, loc->tags, loc->tagMask, folded, hash);
+}
+
+/* Free a tag's slot once its list is empty */
+static void tagIndexDelete(LocationIndex* loc, TagSlot* slot)
+{
+    probeDelete(&tagSlotLayout, loc->tags, loc->tagMask, slot);
+    loc->tagCount--;
+}
+
+/*
+ * Make room for count tags.  Returns -1 when out of memory, leaving the
+ * index as it was.
+ */
+static int tagIndexReserve(LocationIndex* loc, size_t count)
+{
+    void* slots = loc->tags;
+    if (probeReserve(&tagSlotLayout, &slots, &loc->tagMask, count, TAG_INDEX_MIN_SLOTS) != 0) {
+        return -1;
+    }
+    loc->tags = (TagSlot*)slots;
+    return 0;
+}
+
+/*
+ * The list for a location, or NULL when it is not indexed.  For a trailer
+ * tag not seen before, create claims a slot, which the caller has made
+ * room for.  *taken and *bit give the location's occupancy bit; *taken is
+ * NULL for trailer tags, which have none.
+ */
+static LocationList* locationSlot(LocationIndex* loc, LocationCategory cat,
+                                  const LocDetails* where, int create,
+                                  uint64_t** taken, int* bit)
+{
+    *taken = NULL;
+    *bit   = 0;
+    switch (cat) {
+        case SLIP:
+            if (where->slipNo < 1 || where->slipNo > MAX_SLIP_NUM) {
+                return NULL;
+            }
+            *taken = loc->slipsTaken;
+            *bit   = where->slipNo;
+            return &loc->slips[where->slipNo];
+        case LAND: {
+            int bay = bayNumber(where->bayLabel);
+            if (bay < 0) {
+                return NULL;
+            }
+            *taken = loc->baysTaken;
+            *bit   = bay;
+            return &loc->bays[bay];
+        }
+        case TRAILOR: {
+            char   folded[sizeof(where->trailerTag)];
+            size_t len = strnlen(where->trailerTag, sizeof(folded) - 1);
+            if (len == 0 || !loc->tags) {
+                return NULL;
+            }
+            foldName(folded, where->trailerTag, len);
+            uint64_t hash = hashName(folded, len);
+            TagSlot* slot = tagIndexProbe(loc, folded, hash);
+            if (!slot->tag[0]) {
+                if (!create) {
+                    return NULL;
+                }
+                memcpy(slot->tag, folded, len + 1);
+                slot->hash = (uint32_t)hash;
+                loc->tagCount++;
+            }
+            return &slot->boats;
+        }
+        case STORAGE:
+            if (where->storageSpot < 1 || where->storageSpot > MAX_STORAGE_LOC) {
+                return NULL;
+            }
+            *taken = loc->storageTaken;
+            *bit   = where->storageSpot;
+            return &loc->storage[where->storageSpot];
+    }
+    return NULL;
+}
+
+/*
+ * Put a boat at the end of its location's list.  A second boat in a slip
+ * or storage spot is counted as a conflict.  Returns -1 when out of
+ * memory for a new trailer tag.
+ */
+int locationIndexAdd(LocationIndex* loc, Vessel* boat)
+{
+    uint64_t* taken;
+    int       bit;
+
+    if (boat->locationCat == TRAILOR && tagIndexReserve(loc, loc->tagCount + 1) != 0) {
+        return -1;
+    }
+    boat->locPrev = NULL;
+    boat->locNext = NULL;
+    LocationList* list = locationSlot(loc, boat->locationCat, &boat->locationInfo, 1,
+                                      &taken, &bit);
+    if (!list) {
+        return 0;
+    }
+    boat->locPrev = list->tail;
+    if (list->tail) {
+        list->tail->locNext = boat;
+    } else {
+        list->head = boat;
+    }
+    list->tail = boat;
+    if (++list->count == 2 && locationIsExclusive(boat->locationCat)) {
+        loc->conflicts++;
+    }
+    if (taken) {
+        bitSet(taken, bit);
+    }
+    return 0;
+}
+
+/*
+ * Take a boat off its location's list, in O(1).  A trailer tag left with
+ * no boats gives up its slot.
+ */
+void locationIndexRemove(LocationIndex* loc, Vessel* boat)
+{
+    uint64_t* taken;
+    int       bit;
+
+    LocationList* list = locationSlot(loc, boat->locationCat, &boat->locationInfo, 0,
+                                      &taken, &bit);
+    if (!list) {
+        return;
+    }
+    if (boat->locPrev) {
+        boat->locPrev->locNext = boat->locNext;
+    } else {
+        list->head = boat->locNext;
+    }
+    if (boat->locNext) {
+        boat->locNext->locPrev = boat->locPrev;
+    } else {
+        list->tail = boat->locPrev;
+    }
+    boat->locPrev = NULL;
+    boat->locNext = NULL;
+    if (list->count-- == 2 && locationIsExclusive(boat->locationCat)) {
+        loc->conflicts--;
+    }
+    if (list->count == 0 && taken) {
+        bitClear(taken, bit);
+    } else if (list->count == 0) {
+        tagIndexDelete(loc, (TagSlot*)((char*)list - offsetof(TagSlot, boats)));
+    }
+}
+
+/*
+ * Index count vessels from scratch, skipping tombstones.  Returns -1 when
+ * out of memory, leaving the index empty.
+ */
+int locationIndexBuild(LocationIndex* loc, Vessel** vessels, int count)
+{
+    locationIndexFree(loc);
+    for (int i = 0; i < count; i++) {
+        if (!vessels[i]->removed && locationIndexAdd(loc, vessels[i]) != 0) {
+            locationIndexFree(loc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The boats at a location, or NULL when none has ever been indexed there
+ */
+const LocationList* locationIndexFind(const LocationIndex* loc, LocationCategory cat,
+                                      const LocDetails* where)
+{
+    uint64_t* taken;
+    int       bit;
+    return locationSlot((LocationIndex*)loc, cat, where, 0, &taken, &bit);
+}
+
+/*
+ * The lowest free slip or storage spot, or 0 when every one is taken.
+ * The taken set is read a word at a time, inverted, and the first free
+ * number is its trailing-zero count, so this is O(1) for the marina's
+ * sizes.
+ */
+int locationIndexFirstFree(const LocationIndex* loc, LocationCategory cat)
+{
+    const uint64_t* taken;
+    int             last;
+
+    switch (cat) {
+        case SLIP:
+            taken = loc->slipsTaken;
+            last  = MAX_SLIP_NUM;
+            break;
+        case STORAGE:
+            taken = loc->storageTaken;
+            last  = MAX_STORAGE_LOC;
+            break;
+        default:
+            return 0;
+    }
+    for (int w = 0; w * 64 <= last; w++) {
+        uint64_t open = ~taken[w];
+        if (w == 0) {
+            open &= ~1ULL;                      /* numbering starts at 1 */
+        }
+        if (last - w * 64 < 63) {
+            open &= (2ULL << (last - w * 64)) - 1;
+        }
+        if (open) {
+            return w * 64 + countTrailingZeros(open);
+        }
+    }
+    return 0;
+}
+
+void locationIndexFree(LocationIndex* loc)
+{
+    free(loc->tags);
+    locationIndexInit(loc);
+}
+
+void treeInit(VesselTree* tree)
+{
+    tree->root   = NULL;
+    tree->first  = NULL;
+    tree->spare  = NULL;
+    tree->height = 0;
+    tree->count  = 0;
+}
+
+static void treeFreeNode(TreeNode* node)
+{
+    if (!node->leaf) {
+        for (int i = 0; i < node->count; i++) {
+            treeFreeNode(node->children[i]);
+        }
+    }
+    free(node);
+}
+
+void treeFree(VesselTree* tree)
+{
+    if (tree->root) {
+        treeFreeNode(tree->root);
+    }
+    while (tree->spare) {
+        TreeNode* next = tree->spare->next;
+        free(tree->spare);
+        tree->spare = next;
+    }
+    treeInit(tree);
+}
+
+/* A cleared node from the spare list */
+static TreeNode* treeTakeNode(VesselTree* tree, int leaf)
+{
+    TreeNode* node = tree->spare;
+    tree->spare = node->next;
+    memset(node, 0, sizeof(*node));
+    node->leaf = leaf;
+    return node;
+}
+
+/*
+ * Set aside count nodes.  Returns -1 when out of memory.
+ */
+static int treeReserveNodes(VesselTree* tree, int count)
+{
+    int have = 0;
+    for (TreeNode* node = tree->spare; node && have < count; node = node->next) {
+        have++;
+    }
+    for (; have < count; have++) {
+        TreeNode* node = (TreeNode*)malloc(sizeof(TreeNode));
+        if (!node) {
+            return -1;
+        }
+        node->next  = tree->spare;
+        tree->spare = node;
+    }
+    return 0;
+}
+
+/*
+ * Child of a branch to follow for name: the last whose key is below it,
+ * or with orEqual the last whose key is not above it
+ */
+static int treeRoute(const TreeNode* node, const char* name, int orEqual)
+{
+    int lo = 1;
+    int hi = node->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(node->keys[mid], name);
+        if (cmp < 0 || (orEqual && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+/*
+ * Build the tree from count vessels already in name order, filling nodes
+ * to TREE_BUILD_FILL so that later inserts rarely split.  Returns -1 when
+ * out of memory, leaving the tree empty.
+ */
+int treeBuild(VesselTree* tree, Vessel** sorted, int count)
+{
+    treeFree(tree);
+    if (count == 0) {
+        return 0;
+    }
+
+    /* Leaves, with the entries spread evenly over them */
+    int leaves = count > TREE_FANOUT ? (count + TREE_BUILD_FILL - 1) / TREE_BUILD_FILL : 1;
+    TreeNode** level = (TreeNode**)malloc((size_t)leaves * sizeof(TreeNode*));
+    if (!level || treeReserveNodes(tree, leaves) != 0) {
+        free(level);
+        treeFree(tree);
+        return -1;
+    }
+    int       done = 0;
+    TreeNode* prev = NULL;
+    for (int i = 0; i < leaves; i++) {
+        TreeNode* leaf = treeTakeNode(tree, 1);
+        int       end  = (int)((long long)count * (i + 1) / leaves);
+        leaf->count = end - done;
+        memcpy(leaf->vessels, sorted + done, (size_t)leaf->count * sizeof(Vessel*));
+        leaf->prev = prev;
+        if (prev) {
+            prev->next = leaf;
+        }
+        prev     = leaf;
+        level[i] = leaf;
+        done     = end;
+    }
+    tree->first  = level[0];
+    tree->height = 1;
+
+    /* Branch levels until a single node is left */
+    int nodes = leaves;
+    while (nodes > 1) {
+        int parents = nodes > TREE_FANOUT ? (nodes + TREE_BUILD_FILL - 1) / TREE_BUILD_FILL : 1;
+        if (treeReserveNodes(tree, parents) != 0) {
+            for (int i = 0; i < nodes; i++) {
+                treeFreeNode(level[i]);
+            }
+            free(level);
+            treeFree(tree);
+            return -1;
+        }
+        done = 0;
+        for (int i = 0; i < parents; i++) {
+            TreeNode* branch = treeTakeNode(tree, 0);
+            int       end    = (int)((long long)nodes * (i + 1) / parents);
+            for (int c = done; c < end; c++) {
+                TreeNode* child = level[c];
+                TreeNode* left  = child;
+                while (!left->leaf) {
+                    left = left->children[0];
+                }
+                branch->children[branch->count] = child;
+                branch->keys[branch->count]     = left->vessels[0]->foldedName;
+                branch->count++;
+            }
+            level[i] = branch;
+            done     = end;
+        }
+        nodes = parents;
+        tree->height++;
+    }
+    tree->root  = level[0];
+    tree->count = count;
+    free(level);
+    return 0;
+}
+
+/*
+ * Insert into the subtree under node.  If node had to split, the new
+ * right half is returned with its lowest name in *splitKey.
+ */
+static TreeNode* treeInsertAt(VesselTree* tree, TreeNode* node, Vessel* boat,
+                              const char** splitKey)
+{
+    const char* name = boat->foldedName;
+
+    if (node->leaf) {
+        int pos = 0;
+        while (pos < node->count && strcmp(node->vessels[pos]->foldedName, name) <= 0) {
+            pos++;
+        }
+        Vessel* all[TREE_FANOUT + 1];
+        memcpy(all, node->vessels, (size_t)pos * sizeof(Vessel*));
+        all[pos] = boat;
+        memcpy(all + pos + 1, node->vessels + pos, (size_t)(node->count - pos) * sizeof(Vessel*));
+        if (node->count < TREE_FANOUT) {
+            memcpy(node->vessels, all, (size_t)(node->count + 1) * sizeof(Vessel*));
+            node->count++;
+            return NULL;
+        }
+
+        TreeNode* right = treeTakeNode(tree, 1);
+        node->count  = (TREE_FANOUT + 1) / 2;
+        right->count = TREE_FANOUT + 1 - node->count;
+        memcpy(node->vessels, all, (size_t)node->count * sizeof(Vessel*));
+        memcpy(right->vessels, all + node->count, (size_t)right->count * sizeof(Vessel*));
+        right->prev = node;
+        right->next = node->next;
+        if (node->next) {
+            node->next->prev = right;
+        }
+        node->next = right;
+        *splitKey  = right->vessels[0]->foldedName;
+        return right;
+    }
+
+    int         child = treeRoute(node, name, 1);
+    const char* key;
+    TreeNode*   split = treeInsertAt(tree, node->children[child], boat, &key);
+    if (!split) {
+        return NULL;
+    }
+
+    const char* keys[TREE_FANOUT + 1];
+    TreeNode*   children[TREE_FANOUT + 1];
+    int         pos = child + 1;
+    memcpy(keys, node->keys, (size_t)pos * sizeof(const char*));
+    memcpy(children, node->children, (size_t)pos * sizeof(TreeNode*));
+    keys[pos]     = key;
+    children[pos] = split;
+    memcpy(keys + pos + 1, node->keys + pos, (size_t)(node->count - pos) * sizeof(const char*));
+    memcpy(children + pos + 1, node->children + pos,
+           (size_t)(node->count - pos) * sizeof(TreeNode*));
+    if (node->count < TREE_FANOUT) {
+        node->count++;
+        memcpy(node->keys, keys, (size_t)node->count * sizeof(const char*));
+        memcpy(node->children, children, (size_t)node->count * sizeof(TreeNode*));
+        return NULL;
+    }
+
+    TreeNode* right = treeTakeNode(tree, 0);
+    node->count  = (TREE_FANOUT + 1) / 2;
+    right->count = TREE_FANOUT + 1 - node->count;
+    memcpy(node->keys, keys, (size_t)node->count * sizeof(const char*));
+    memcpy(node->children, children, (size_t)node->count * sizeof(TreeNode*));
+    memcpy(right->keys, keys + node->count, (size_t)right->count * sizeof(const char*));
+    memcpy(right->children, children + node->count, (size_t)right->count * sizeof(TreeNode*));
+    *splitKey = right->keys[0];
+    return right;
+}
+
+/*
+ * Add a vessel after any others of the same name.  Returns -1 when out of
+ * memory, leaving the tree as it was.
+ */
+int treeInsert(VesselTree* tree, Vessel* boat)
+{
+    if (treeReserveNodes(tree, tree->height + 1) != 0) {
+        return -1;
+    }
+    if (!tree->root) {
+        tree->root   = treeTakeNode(tree, 1);
+        tree->first  = tree->root;
+        tree->height = 1;
+    }
+
+    const char* key;
+    TreeNode*   split = treeInsertAt(tree, tree->root, boat, &key);
+    if (split) {
+        TreeNode* root = treeTakeNode(tree, 0);
+        root->count       = 2;
+        root->children[0] = tree->root;
+        root->children[1] = split;
+        root->keys[1]     = key;
+        tree->root        = root;
+        tree->height++;
+    }
+    tree->count++;
+    return 0;
+}
+
+/*
+ * Refill children[c] of node, which has fallen below TREE_MIN_FILL, by
+ * borrowing from a neighbour that can spare an entry or else merging with
+ * one
+ */
+static void treeRebalance(TreeNode* node, int c)
+{
+    TreeNode* child = node->children[c];
+    TreeNode* left  = c > 0 ? node->children[c - 1] : NULL;
+    TreeNode* right = c + 1 < node->count ? node->children[c + 1] : NULL;
+
+    if (left && left->count > TREE_MIN_FILL) {
+        int last = left->count - 1;
+        if (child->leaf) {
+            memmove(child->vessels + 1, child->vessels, (size_t)child->count * sizeof(Vessel*));
+            child->vessels[0] = left->vessels[last];
+            node->keys[c]     = child->vessels[0]->foldedName;
+        } else {
+            memmove(child->children + 1, child->children,
+                    (size_t)child->count * sizeof(TreeNode*));
+            memmove(child->keys + 1, child->keys, (size_t)child->count * sizeof(const char*));
+            child->children[0] = left->children[last];
+            child->keys[1]     = node->keys[c];
+            node->keys[c]      = left->keys[last];
+        }
+        child->count++;
+        left->count--;
+        return;
+    }
+    if (right && right->count > TREE_MIN_FILL) {
+        if (child->leaf) {
+            child->vessels[child->count] = right->vessels[0];
+            memmove(right->vessels, right->vessels + 1,
+                    (size_t)(right->count - 1) * sizeof(Vessel*));
+            node->keys[c + 1] = right->vessels[0]->foldedName;
+        } else {
+            child->children[child->count] = right->children[0];
+            child->keys[child->count]     = node->keys[c + 1];
+            node->keys[c + 1]             = right->keys[1];
+            memmove(right->children, right->children + 1,
+                    (size_t)(right->count - 1) * sizeof(TreeNode*));
+            memmove(right->keys + 1, right->keys + 2,
+                    (size_t)(right->count - 2) * sizeof(const char*));
+        }
+        child->count++;
+        right->count--;
+        return;
+    }
+
+    /* Merge the pair into its left node and drop the right one */
+    int       j    = left ? c : c + 1;
+    TreeNode* into = node->children[j - 1];
+    TreeNode* gone = node->children[j];
+    if (into->leaf) {
+        memcpy(into->vessels + into->count, gone->vessels, (size_t)gone->count * sizeof(Vessel*));
+        into->next = gone->next;
+        if (gone->next) {
+            gone->next->prev = into;
+        }
+    } else {
+        into->keys[into->count] = node->keys[j];
+        memcpy(into->keys + into->count + 1, gone->keys + 1,
+               (size_t)(gone->count - 1) * sizeof(const char*));
+        memcpy(into->children + into->count, gone->children,
+               (size_t)gone->count * sizeof(TreeNode*));
+    }
+    into->count += gone->count;
+    free(gone);
+    memmove(node->keys + j, node->keys + j + 1,
+            (size_t)(node->count - j - 1) * sizeof(const char*));
+    memmove(node->children + j, node->children + j + 1,
+            (size_t)(node->count - j - 1) * sizeof(TreeNode*));
+    node->count--;
+}
+
+/*
+ * Remove boat from the subtree under node.  Boats of the same name can
+ * span several children, so each child that may hold the name is tried.
+ */
+static int treeRemoveAt(TreeNode* node, const Vessel* boat)
+{
+    if (node->leaf) {
+        for (int i = 0; i < node->count; i++) {
+            if (node->vessels[i] == boat) {
+                memmove(node->vessels + i, node->vessels + i + 1,
+                        (size_t)(node->count - i - 1) * sizeof(Vessel*));
+                node->count--;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    int first = treeRoute(node, boat->foldedName, 0);
+    for (int c = first; c < node->count; c++) {
+        if (c > first && strcmp(node->keys[c], boat->foldedName) > 0) {
+            break;
+        }
+        if (treeRemoveAt(node->children[c], boat)) {
+            if (node->children[c]->count < TREE_MIN_FILL && node->count > 1) {
+                treeRebalance(node, c);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Remove a vessel.  Returns -1 if it is not in the tree.
+ */
+int treeRemove(VesselTree* tree, const Vessel* boat)
+{
+    if (!tree->root || !treeRemoveAt(tree->root, boat)) {
+        return -1;
+    }
+    while (!tree->root->leaf && tree->root->count == 1) {
+        TreeNode* root = tree->root;
+        tree->root = root->children[0];
+        free(root);
+        tree->height--;
+    }
+    tree->count--;
+    return 0;
+}
+
+/*
+ * The first vessel with an already folded name that has not been
+ * removed, or NULL
+ */
+Vessel* treeFind(const VesselTree* tree, const char* folded)
+{
+    TreeNode* node = tree->root;
+    if (!node) {
+        return NULL;
+    }
+    while (!node->leaf) {
+        node = node->children[treeRoute(node, folded, 0)];
+    }
+    for (; node; node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            int cmp = strcmp(node->vessels[i]->foldedName, folded);
+            if (cmp > 0) {
+                return NULL;
+            }
+            if (cmp == 0 && !node->vessels[i]->removed) {
+                return node->vessels[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Point at the first vessel whose folded name is not below folded
+ */
+void treeSeek(const VesselTree* tree, const char* folded, TreeCursor* at)
+{
+    TreeNode* node = tree->root;
+    at->leaf = NULL;
+    at->pos  = 0;
+    if (!node) {
+        return;
+    }
+    while (!node->leaf) {
+        node = node->children[treeRoute(node, folded, 0)];
+    }
+    int lo = 0;
+    int hi = node->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(node->vessels[mid]->foldedName, folded) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    at->leaf = node;
+    at->pos  = lo;
+}
+
+/*
+ * The vessel at the cursor, moving it on, or NULL past the last one
+ */
+Vessel* treeNext(TreeCursor* at)
+{
+    while (at->leaf && at->pos == at->leaf->count) {
+        at->leaf = at->leaf->next;
+        at->pos  = 0;
+    }
+    return at->leaf ? at->leaf->vessels[at->pos++] : NULL;
+}
+
+/*
+ * Start an empty fleet; storage is allocated on the first append
+ */
+void fleetInit(Fleet* fleet)
+{
+    fleet->vessels      = NULL;
+    fleet->count        = 0;
+    fleet->capacity     = 0;
+    fleet->tombstones   = 0;
+    fleet->vesselsStale = 0;
+    treeInit(&fleet->order);
+    poolInit(&fleet->pool);
+    namePoolInit(&fleet->names);
+    nameIndexInit(&fleet->index);
+    locationIndexInit(&fleet->locations);
+    fleet->billingEpoch = 0;
+    fleet->deferBilling = 0;
+    fleet->rejected     = 0;
+}
+
+/*
+ * Make room for at least capacity vessels, at least doubling the array
+ * so that repeated appends stay amortized O(1).  Returns -1 when out of
+ * memory, leaving the fleet as it was.
+ */
+int fleetReserve(Fleet* fleet, int capacity)
+{
+    if (capacity <= fleet->capacity) {
+        return 0;
+    }
+
+    int newCap = fleet->capacity ? fleet->capacity : FLEET_INITIAL_CAPACITY;
+    while (newCap < capacity) {
+        newCap = newCap > INT_MAX / 2 ? capacity : newCap * 2;
+    }
+    Vessel** grown = (Vessel**)realloc(fleet->vessels, (size_t)newCap * sizeof(Vessel*));
+    if (!grown) {
+        return -1;
+    }
+    fleet->vessels  = grown;
+    fleet->capacity = newCap;
+    return 0;
+}
+
+/*
+ * Add a vessel at the end of the array and index its name.  For bulk
+ * loads, which sort the array and call fleetBuildOrder once done.
+ */
+int fleetAppend(Fleet* fleet, Vessel* boat)
+{
+    if (fleet->count == fleet->capacity &&
+        (fleet->count == INT_MAX || fleetReserve(fleet, fleet->count + 1) != 0)) {
+        return -1;
+    }
+    if (nameIndexAdd(&fleet->index, boat) != 0) {
+        return -1;
+    }
+    fleet->vessels[fleet->count++] = boat;
+    return 0;
+}
+
+/*
+ * Copy a parsed vessel into a pooled record and intern its name.  It owes
+ * nothing for months billed before it joined.
+ */
+static Vessel* fleetNewRecord(Fleet* fleet, const Vessel* boat)
+{
+    const char* folded;
+    const char* name = namePoolAdd(&fleet->names, boat->vesselName, boat->nameLen, &folded);
+    if (!name) {
+        return NULL;
+    }
+    Vessel* newBoat = poolAlloc(&fleet->pool);
+    if (!newBoat) {
+        return NULL;
+    }
+    *newBoat = *boat;
+    newBoat->vesselName   = name;
+    newBoat->foldedName   = folded;
+    newBoat->settledEpoch = fleet->billingEpoch;
+    newBoat->removed      = 0;
+    return newBoat;
+}
+
+/*
+ * Add a parsed vessel to the end of the array, for bulk loads.  Returns
+ * the new record, or NULL when out of memory.
+ */
+Vessel* fleetAdd(Fleet* fleet, const Vessel* boat)
+{
+    Vessel* newBoat = fleetNewRecord(fleet, boat);
+    if (newBoat && fleetAppend(fleet, newBoat) != 0) {
+        poolFree(&fleet->pool, newBoat);
+        return NULL;
+    }
+    return newBoat;
+}
+
+/*
+ * Build the name order from the array once a bulk load has sorted it, and
+ * index where the boats are.  If that runs out of memory the fleet is
+ * emptied and -1 returned, for the load to fail as a whole.
+ */
+int fleetBuildOrder(Fleet* fleet)
+{
+    if (treeBuild(&fleet->order, fleet->vessels, fleet->count) != 0 ||
+        locationIndexBuild(&fleet->locations, fleet->vessels, fleet->count) != 0) {
+        printf("Error: memory allocation failed.\n");
+        freeVesselMemory(fleet);
+        return -1;
+    }
+    fleet->vesselsStale = 0;
+    return 0;
+}
+
+/*
+ * The vessels in name order as one array, tombstones included, rebuilt
+ * from the tree if boats were added since it was last needed
+ */
+Vessel** fleetVessels(Fleet* fleet)
+{
+    if (fleet->vesselsStale) {
+        int n = 0;
+        for (TreeNode* leaf = fleet->order.first; leaf; leaf = leaf->next) {
+            memcpy(fleet->vessels + n, leaf->vessels, (size_t)leaf->count * sizeof(Vessel*));
+            n += leaf->count;
+        }
+        fleet->vesselsStale = 0;
+    }
+    return fleet->vessels;
+}
+
+/*
+ * Add a parsed vessel in name order, after any boats of the same name.
+ * Returns the new record, or NULL when out of memory.
+ */
+Vessel* fleetInsert(Fleet* fleet, const Vessel* boat)
+{
+    if (fleet->count == INT_MAX || fleetReserve(fleet, fleet->count + 1) != 0) {
+        return NULL;
+    }
+    Vessel* newBoat = fleetNewRecord(fleet, boat);
+    if (!newBoat) {
+        return NULL;
+    }
+    if (locationIndexAdd(&fleet->locations, newBoat) != 0) {
+        poolFree(&fleet->pool, newBoat);
+        return NULL;
+    }
+    if (treeInsert(&fleet->order, newBoat) != 0) {
+        locationIndexRemove(&fleet->locations, newBoat);
+        poolFree(&fleet->pool, newBoat);
+        return NULL;
+    }
+    if (nameIndexAdd(&fleet->index, newBoat) != 0) {
+        treeRemove(&fleet->order, newBoat);
+        locationIndexRemove(&fleet->locations, newBoat);
+        poolFree(&fleet->pool, newBoat);
+        return NULL;
+    }
+    fleet->count++;
+    fleet->vesselsStale = 1;
+    return newBoat;
+}
+
+/*
+ * The vessels in name order with no tombstones, for writing the fleet out
+ */
+Vessel** fleetLiveVessels(Fleet* fleet)
+{
+    fleetPurge(fleet);
+    return fleetVessels(fleet);
+}
+
+/*
+ * Remove a boat by marking it a tombstone, which leaves the order and the
+ * array as they are; it leaves its location at once.  It only has to be
+ * looked for in the tree when another boat of the same name takes its
+ * place in the name index, so this is O(1) for distinct names.
+ * Tombstones are purged once they are more than 1 in TOMBSTONE_RATIO, so
+ * each removal costs O(1) amortized.
+ */
+void fleetRemove(Fleet* fleet, Vessel* boat)
+{
+    boat->removed = 1;
+    fleet->tombstones++;
+    nameIndexRemove(&fleet->index, boat, &fleet->order);
+    locationIndexRemove(&fleet->locations, boat);
+    if (fleet->tombstones > fleet->count / TOMBSTONE_RATIO) {
+        fleetPurge(fleet);
+    }
+}
+
+/*
+ * Take every tombstone out of the tree, compact the array and free the
+ * records
+ */
+void fleetPurge(Fleet* fleet)
+{
+    if (fleet->tombstones == 0) {
+        return;
+    }
+    Vessel** vessels = fleetVessels(fleet);
+    int      kept    = 0;
+    for (int i = 0; i < fleet->count; i++) {
+        Vessel* v = vessels[i];
+        if (v->removed) {
+            treeRemove(&fleet->order, v);
+            poolFree(&fleet->pool, v);
+        } else {
+            vessels[kept++] = v;
+        }
+    }
+    fleet->count      = kept;
+    fleet->tombstones = 0;
+}
+
+/*
+ * Load the CSV a line at a time.  A missing file loads as an empty fleet.
+ * Returns -1 when out of memory.
+ */
+int loadData(const char* fileName, Fleet* fleet)
+{
+    FILE* fp = fopen(fileName, "r");
+    if (!fp) {
+        printf("Warning: Could not open %s for reading.\n", fileName);
+        return 0;
+    }
+
+    /* Whole lines, however long, so a long name is never split into two records */
+    char*   line   = NULL;
+    size_t  size   = 0;
+    long    lineNo = 0;
+    int     status = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &size, fp)) != -1) {
+        Vessel parsed;
+        lineNo++;
+        if (strspn(line, ",\r\n") == (size_t)len) {
+            continue;
+        }
+        if (parseVesselRecord(line, (size_t)len, &parsed) != 0) {
+            FieldSlice text = { line, (size_t)len };
+            reportRejectedLine(fleet, lineNo, text);
+            continue;
+        }
+
+        if (!fleetAdd(fleet, &parsed)) {
+            printf("Error: memory allocation failed.\n");
+            status = -1;
+            break;
+        }
+    }
+    free(line);
+    fclose(fp);
+    if (status != 0) {
+        return -1;
+    }
+
+    /* Sort vessels by name for consistent ordering */
+    qsort(fleet->vessels, fleet->count, sizeof(Vessel*), compareVessels);
+    return fleetBuildOrder(fleet);
+}
+
+/*
+ * Map the whole data file read-only.  Falls back to reading it into a
+ * single heap buffer where mmap is not available.
+ */
+int mapDataFile(const char* fileName, MappedFile* mf)
+{
+    mf->data   = NULL;
+    mf->size   = 0;
+    mf->mapped = 0;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+#ifndef _WIN32
+    void* addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+        madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+        close(fd);
+        mf->data   = (const char*)addr;
+        mf->size   = (size_t)st.st_size;
+        mf->mapped = 1;
+        return 0;
+    }
+#endif
+
+    char*  buf  = (char*)malloc((size_t)st.st_size);
+    size_t done = 0;
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    while (done < (size_t)st.st_size) {
+        ssize_t got = read(fd, buf + done, (size_t)st.st_size - done);
+        if (got <= 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    close(fd);
+    mf->data = buf;
+    mf->size = done;
+    return 0;
+}
+
+void unmapDataFile(MappedFile* mf)
+{
+#ifndef _WIN32
+    if (mf->mapped) {
+        munmap((void*)mf->data, mf->size);
+        mf->data = NULL;
+        return;
+    }
+#endif
+    free((void*)mf->data);
+    mf->data = NULL;
+}
+
+/* Bit i of the result is set when block[i] is a comma or a newline */
+static uint64_t structuralMaskScalar(const char* block)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        if (block[i] == ',' || block[i] == '\n') {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+    return mask;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static uint64_t structuralMaskSse2(const char* block)
+{
+    const __m128i comma   = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t      mask    = 0;
+
+    for (int i = 0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        __m128i hits  = _mm_or_si128(_mm_cmpeq_epi8(bytes, comma),
+                                     _mm_cmpeq_epi8(bytes, newline));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hits) << (16 * i);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t structuralMaskAvx2(const char* block)
+{
+    const __m256i comma   = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i       lo      = _mm256_loadu_si256((const __m256i*)block);
+    __m256i       hi      = _mm256_loadu_si256((const __m256i*)(block + 32));
+
+    lo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, comma), _mm256_cmpeq_epi8(lo, newline));
+    hi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, comma), _mm256_cmpeq_epi8(hi, newline));
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) |
+           (uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32;
+}
+#endif
+
+/* Block kernel picked once at startup by initScanKernel */
+static uint64_t (*structuralMask)(const char* block) = structuralMaskScalar;
+
+/*
+ * Choose the widest structural scanner this CPU supports
+ */
+void initScanKernel()
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        structuralMask = structuralMaskAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        structuralMask = structuralMaskSse2;
+    }
+#endif
+}
+
+static uint64_t loadBlockMask(const char* data, size_t len, size_t block)
+{
+    if (block + 64 <= len) {
+        return structuralMask(data + block);
+    }
+    char tail[64] = { 0 };
+    memcpy(tail, data + block, len - block);
+    return structuralMask(tail);
+}
+
+void scannerInit(StructScanner* sc, const char* data, size_t len)
+{
+    sc->data  = data;
+    sc->len   = len;
+    sc->pos   = 0;
+    sc->block = 0;
+    sc->mask  = len > 0 ? loadBlockMask(data, len, 0) : 0;
+}
+
+/*
+ * Offset of the next comma or newline, or len once there are none left
+ */
+size_t scannerNext(StructScanner* sc)
+{
+    while (sc->mask == 0) {
+        if (sc->block + 64 >= sc->len) {
+            return sc->len;
+        }
+        sc->block += 64;
+        sc->mask = loadBlockMask(sc->data, sc->len, sc->block);
+    }
+    size_t offset = sc->block + (size_t)countTrailingZeros(sc->mask);
+    sc->mask &= sc->mask - 1;
+    return offset;
+}
+
+/*
+ * Collect the fields of the next record, up to maxFields of them; any
+ * further fields on the line are skipped.  Runs of commas count as one
+ * separator, the same way strtok_r treats them, and a trailing '\r' is
+ * dropped.  Returns the number of fields, or -1 at the end of the input.
+ */
+int scanRecord(StructScanner* sc, FieldSlice* fields, int maxFields)
+{
+    int count = 0;
+
+    if (sc->pos >= sc->len) {
+        return -1;
+    }
+    for (;;) {
+        size_t stop   = scannerNext(sc);
+        int    atEnd  = stop == sc->len || sc->data[stop] == '\n';
+        size_t length = stop - sc->pos;
+
+        if (atEnd && length > 0 && sc->data[stop - 1] == '\r') {
+            length--;
+        }
+        if (length > 0 && count < maxFields) {
+            fields[count].start = sc->data + sc->pos;
+            fields[count].len   = length;
+            count++;
+        }
+        sc->pos = stop + 1;
+        if (atEnd) {
+            return count;
+        }
+    }
+}
+
+/* Drop the blanks atof and atoi used to skip */
+static FieldSlice trimBlanks(FieldSlice field)
+{
+    while (field.len > 0 && (*field.start == ' ' || *field.start == '\t')) {
+        field.start++;
+        field.len--;
+    }
+    while (field.len > 0 && (field.start[field.len - 1] == ' ' ||
+                             field.start[field.len - 1] == '\t')) {
+        field.len--;
+    }
+    return field;
+}
+
+/*
+ * Parse a non-negative whole number such as a slip or storage spot.
+ * Returns -1 for an empty field, any stray character, or overflow.
+ */
+int parseWholeNumber(FieldSlice field, int* value)
+{
+    int result = 0;
+
+    field = trimBlanks(field);
+    if (field.len > 0 && *field.start == '+') {
+        field.start++;
+        field.len--;
+    }
+    if (field.len == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < field.len; i++) {
+        unsigned digit = (unsigned)(field.start[i] - '0');
+        if (digit > 9 || result > (0x7FFFFFFF - (int)digit) / 10) {
+            return -1;
+        }
+        result = result * 10 + (int)digit;
+    }
+    *value = result;
+    return 0;
+}
+
+/*
+ * Parse a decimal into a whole number of units of 10^-places, e.g.
+ * "-12.5" with places 2 gives -1250 cents.  Digits past the last place
+ * round half away from zero.
+ */
+int parseFixed(FieldSlice field, int places, int64_t* value)
+{
+    int64_t scale = 1;
+    for (int i = 0; i < places; i++) {
+        scale *= 10;
+    }
+
+    const int64_t limit     = INT64_MAX / scale;
+    int64_t       whole     = 0;
+    int64_t       fraction  = 0;
+    int           decimals  = 0;
+    int           roundUp   = 0;
+    int           negative  = 0;
+    int           seenPoint = 0;
+    int           seenDigit = 0;
+
+    field = trimBlanks(field);
+    if (field.len > 0 && (*field.start == '-' || *field.start == '+')) {
+        negative = *field.start == '-';
+        field.start++;
+        field.len--;
+    }
+    for (size_t i = 0; i < field.len; i++) {
+        char c = field.start[i];
+        if (c == '.' && !seenPoint) {
+            seenPoint = 1;
+            continue;
+        }
+        unsigned digit = (unsigned)(c - '0');
+        if (digit > 9) {
+            return -1;
+        }
+        seenDigit = 1;
+        if (!seenPoint) {
+            if (whole > (limit - (int64_t)digit) / 10) {
+                return -1;
+            }
+            whole = whole * 10 + digit;
+        } else if (decimals < places) {
+            fraction = fraction * 10 + digit;
+            decimals++;
+        } else if (decimals == places) {
+            roundUp = digit >= 5;
+            decimals++;
+        }
+    }
+    if (!seenDigit) {
+        return -1;
+    }
+    for (; decimals < places; decimals++) {
+        fraction *= 10;
+    }
+
+    if (whole > (INT64_MAX - fraction - roundUp) / scale) {
+        return -1;
+    }
+    int64_t result = whole * scale + fraction + roundUp;
+    *value = negative ? -result : result;
+    return 0;
+}
+
+/* Parse a money amount into whole cents */
+int parseMoney(FieldSlice field, int64_t* cents)
+{
+    return parseFixed(field, 2, cents);
+}
+
+/* Copy a short field into a terminated buffer */
+static void sliceToBuffer(FieldSlice field, char* buf, size_t bufSize)
+{
+    size_t n = field.len < bufSize - 1 ? field.len : bufSize - 1;
+    memcpy(buf, field.start, n);
+    buf[n] = '\0';
+}
+
+static int sliceEquals(FieldSlice field, const char* word, int ignoreCase)
+{
+    size_t n = strlen(word);
+    if (field.len != n) {
+        return 0;
+    }
+    return ignoreCase ? strncasecmp(field.start, word, n) == 0
+                      : memcmp(field.start, word, n) == 0;
+}
+
+/*
+ * Fill a Vessel from the name, length, category, detail and fee fields of
+ * one record.  Data files spell categories in lower case; interactive input
+ * may use any case.
+ */
+ParseStatus decodeVesselFields(const FieldSlice* field, int count, Vessel* boat, int ignoreCase)
+{
+    int64_t hundredths;
+
+    if (count < 3) {
+        return PARSE_BAD_FORMAT;
+    }
+
+    /* The name is borrowed from the input; a NUL ends it as it always has */
+    const char* nul = (const char*)memchr(field[0].start, '\0', field[0].len);
+    boat->vesselName = field[0].start;
+    boat->foldedName = NULL;
+    boat->nameLen    = (uint32_t)(nul ? (size_t)(nul - field[0].start) : field[0].len);
+
+    if (parseFixed(field[1], 2, &hundredths) != 0 || hundredths < 0 ||
+        hundredths > INT32_MAX) {
+        return PARSE_BAD_NUMBER;
+    }
+    boat->lengthHundredths = (int32_t)hundredths;
+
+    ParseStatus status = decodeLocationFields(field + 2, count - 2, &boat->locationCat,
+                                              &boat->locationInfo, ignoreCase);
+    if (status != PARSE_OK) {
+        return status;
+    }
+
+    if (count < 5) {
+        return PARSE_MISSING_FEE;
+    }
+    if (parseMoney(field[4], &boat->outstandingFees) != 0) {
+        return PARSE_BAD_NUMBER;
+    }
+    return PARSE_OK;
+}
+
+/*
+ * Fill a location from a category field and the detail field after it,
+ * as in a record or a location query
+ */
+ParseStatus decodeLocationFields(const FieldSlice* field, int count, LocationCategory* cat,
+                                 LocDetails* where, int ignoreCase)
+{
+    if (sliceEquals(field[0], "slip", ignoreCase)) {
+        *cat = SLIP;
+    } else if (sliceEquals(field[0], "land", ignoreCase)) {
+        *cat = LAND;
+    } else if (sliceEquals(field[0], "trailor", ignoreCase)) {
+        *cat = TRAILOR;
+    } else if (sliceEquals(field[0], "storage", ignoreCase)) {
+        *cat = STORAGE;
+    } else {
+        return PARSE_UNKNOWN_LOCATION;
+    }
+
+    if (count < 2) {
+        return PARSE_INCOMPLETE;
+    }
+    switch (*cat) {
+        case SLIP:
+            if (parseWholeNumber(field[1], &where->slipNo) != 0) {
+                return PARSE_BAD_NUMBER;
+            }
+            break;
+        case LAND:
+            where->bayLabel = field[1].start[0];
+            break;
+        case TRAILOR:
+            sliceToBuffer(field[1], where->trailerTag, sizeof(where->trailerTag));
+            break;
+        case STORAGE:
+            if (parseWholeNumber(field[1], &where->storageSpot) != 0) {
+                return PARSE_BAD_NUMBER;
+            }
+            break;
+    }
+    return PARSE_OK;
+}
+
+/*
+ * Parse a single data-file line.  Returns 0 on success, -1 if the record
+ * is unusable.
+ */
+int parseVesselRecord(const char* line, size_t len, Vessel* boat)
+{
+    StructScanner sc;
+    FieldSlice    field[5];
+
+    scannerInit(&sc, line, len);
+    int count = scanRecord(&sc, field, 5);
+    return decodeVesselFields(field, count, boat, 0) == PARSE_OK ? 0 : -1;
+}
+
+/*
+ * Count a data file line that holds no usable record, printing the first
+ * few with their line numbers so they can be fixed
+ */
+void reportRejectedLine(Fleet* fleet, long lineNo, FieldSlice line)
+{
+    while (line.len > 0 && (line.start[line.len - 1] == '\n' ||
+                            line.start[line.len - 1] == '\r')) {
+        line.len--;
+    }
+    if (fleet->rejected < MAX_REPORTED_LINES) {
+        printf("Warning: line %ld could not be read: %.*s\n", lineNo,
+               (int)(line.len > 80 ? 80 : line.len), line.start);
+    }
+    fleet->rejected++;
+}
+
+/*
+ * Load the CSV through a memory map.  Records are scanned in place and a
+ * Vessel is only allocated once a line has parsed successfully.  Returns
+ * -1 when out of memory.
+ */
+int loadDataMapped(const char* fileName, Fleet* fleet)
+{
+    MappedFile mf;
+    if (mapDataFile(fileName, &mf) != 0) {
+        printf("Warning: Could not open %s for reading.\n", fileName);
+        return 0;
+    }
+    int status = loadFleetBuffer(fleet, mf.data, mf.size);
+    unmapDataFile(&mf);
+    return status;
+}
+
+/*
+ * Parse every record of an in-memory CSV image into the fleet and put it
+ * in name order.  Lines that do not parse are reported and counted.
+ * Returns -1 when out of memory.
+ */
+int loadFleetBuffer(Fleet* fleet, const char* data, size_t len)
+{
+    StructScanner sc;
+    FieldSlice    field[5];
+    long          lineNo = 0;
+
+    scannerInit(&sc, data, len);
+
+    for (;;) {
+        size_t lineStart = sc.pos;
+        int    count     = scanRecord(&sc, field, 5);
+        Vessel parsed;
+
+        if (count < 0) {
+            break;
+        }
+        lineNo++;
+        if (count == 0) {
+            continue;
+        }
+        if (decodeVesselFields(field, count, &parsed, 0) != PARSE_OK) {
+            FieldSlice text = { data + lineStart, (sc.pos < len ? sc.pos : len) - lineStart };
+            reportRejectedLine(fleet, lineNo, text);
+            continue;
+        }
+        if (!fleetAdd(fleet, &parsed)) {
+            printf("Error: memory allocation failed.\n");
+            return -1;
+        }
+    }
+
+    /* Sort vessels by name for consistent ordering */
+    qsort(fleet->vessels, fleet->count, sizeof(Vessel*), compareVessels);
+    return fleetBuildOrder(fleet);
+}
+
+/*
+ * Run task once per worker on its own thread, handing each the next
+ * argSize-byte element of args, and wait for all of them to finish.
+ */
+void runWorkers(int workers, void* (*task)(void*), void* args, size_t argSize)
+{
+    pthread_t threads[MAX_WORKERS];
+    int       started[MAX_WORKERS];
+
+    for (int i = 0; i < workers; i++) {
+        void* arg  = (char*)args + (size_t)i * argSize;
+        started[i] = pthread_create(&threads[i], NULL, task, arg) == 0;
+        if (!started[i]) {
+            task(arg);
+        }
+    }
+    for (int i = 0; i < workers; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+/*
+ * Worker: parse every line of one chunk into its own fleet and pool.  The
+ * names are indexed once, during the merge, so records are only appended.
+ */
+static void* parseChunkTask(void* arg)
+{
+    LoadChunk*    chunk = (LoadChunk*)arg;
+    Fleet*        fleet = &chunk->fleet;
+    size_t        len   = (size_t)(chunk->end - chunk->begin);
+    StructScanner sc;
+    FieldSlice    field[5];
+    int           count;
+
+    scannerInit(&sc, chunk->begin, len);
+    for (;;) {
+        size_t  lineStart = sc.pos;
+        Vessel  parsed;
+        Vessel* boat;
+
+        if ((count = scanRecord(&sc, field, 5)) < 0) {
+            break;
+        }
+        chunk->lines++;
+        if (count == 0) {
+            continue;
+        }
+        if (decodeVesselFields(field, count, &parsed, 0) != PARSE_OK) {
+            if (chunk->rejected < MAX_REPORTED_LINES) {
+                chunk->rejectedAt[chunk->rejected]         = chunk->lines;
+                chunk->rejectedText[chunk->rejected].start = chunk->begin + lineStart;
+                chunk->rejectedText[chunk->rejected].len   = (sc.pos < len ? sc.pos : len) -
+                                                             lineStart;
+            }
+            chunk->rejected++;
+            continue;
+        }
+        if (fleet->count == INT_MAX || fleetReserve(fleet, fleet->count + 1) != 0 ||
+            !(boat = fleetNewRecord(fleet, &parsed))) {
+            chunk->failed = 1;
+            break;
+        }
+        fleet->vessels[fleet->count++] = boat;
+    }
+    return NULL;
+}
+
+/* Worker: put one chunk's vessels in name order ahead of the merge */
+static void* sortChunkTask(void* arg)
+{
+    LoadChunk* chunk = (LoadChunk*)arg;
+    qsort(chunk->fleet.vessels, chunk->fleet.count, sizeof(Vessel*), compareVessels);
+    return NULL;
+}
+
+/*
+ * Load the CSV on several threads.  The mapped file is cut into one chunk
+ * per worker at newline boundaries, each worker parses and sorts its own
+ * chunk, and the sorted runs are merged into the fleet.  Returns -1 when
+ * out of memory.
+ */
+int loadDataParallel(const char* fileName, Fleet* fleet, int workers)
+{
+    MappedFile mf;
+    LoadChunk  chunks[MAX_WORKERS];
+
+    if (mapDataFile(fileName, &mf) != 0) {
+        printf("Warning: Could not open %s for reading.\n", fileName);
+        return 0;
+    }
+
+    const char* cursor = mf.data;
+    const char* end    = mf.data + mf.size;
+    for (int i = 0; i < workers; i++) {
+        const char* split = end;
+        if (i < workers - 1 && cursor < end) {
+            split = cursor + (size_t)(end - cursor) / (size_t)(workers - i);
+            const char* newline = (const char*)memchr(split, '\n', (size_t)(end - split));
+            split = newline ? newline + 1 : end;
+        }
+        chunks[i].begin    = cursor;
+        chunks[i].end      = split;
+        chunks[i].failed   = 0;
+        chunks[i].lines    = 0;
+        chunks[i].rejected = 0;
+        fleetInit(&chunks[i].fleet);
+        cursor = split;
+    }
+
+    runWorkers(workers, parseChunkTask, chunks, sizeof(LoadChunk));
+
+    /* Report unreadable lines in file order while the text is still mapped */
+    long firstLine = 0;
+    for (int i = 0; i < workers; i++) {
+        long shown = chunks[i].rejected < MAX_REPORTED_LINES ? chunks[i].rejected
+                                                             : MAX_REPORTED_LINES;
+        for (long r = 0; r < shown; r++) {
+            reportRejectedLine(fleet, firstLine + chunks[i].rejectedAt[r],
+                               chunks[i].rejectedText[r]);
+        }
+        fleet->rejected += chunks[i].rejected - shown;
+        firstLine       += chunks[i].lines;
+    }
+    unmapDataFile(&mf);
+
+    long parsed = 0;
+    int  failed = 0;
+    for (int i = 0; i < workers; i++) {
+        parsed += chunks[i].fleet.count;
+        failed |= chunks[i].failed;
+    }
+    if (failed || parsed > INT_MAX || fleetReserve(fleet, (int)parsed) != 0 ||
+        nameIndexReserve(&fleet->index, (size_t)parsed) != 0) {
+        printf("Error: memory allocation failed.\n");
+        for (int i = 0; i < workers; i++) {
+            freeVesselMemory(&chunks[i].fleet);
+        }
+        return -1;
+    }
+
+    runWorkers(workers, sortChunkTask, chunks, sizeof(LoadChunk));
+
+    /* Merge the sorted runs */
+    int next[MAX_WORKERS] = { 0 };
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < workers; i++) {
+            if (next[i] < chunks[i].fleet.count &&
+                (best == -1 || compareVessels(&chunks[i].fleet.vessels[next[i]],
+                                              &chunks[best].fleet.vessels[next[best]]) < 0)) {
+                best = i;
+            }
+        }
+        if (best == -1) {
+            break;
+        }
+        Vessel* boat = chunks[best].fleet.vessels[next[best]++];
+        nameIndexAdd(&fleet->index, boat);
+        fleet->vessels[fleet->count++] = boat;
+    }
+
+    /* The records stay where the workers put them; the fleet takes over their slabs */
+    for (int i = 0; i < workers; i++) {
+        poolSplice(&fleet->pool, &chunks[i].fleet.pool);
+        namePoolSplice(&fleet->names, &chunks[i].fleet.names);
+        freeVesselMemory(&chunks[i].fleet);
+    }
+    return fleetBuildOrder(fleet);
+}
+
+/*
+ * Write updated vessel info back to CSV file
+ */
+int saveData(const char* fileName, Vessel** fleet, int totalCount, int workers)
+{
+    FILE* fp = fopen(fileName, "w");
+    if (!fp) {
+        printf("Error: Could not open file %s for writing.\n", fileName);
+        return -1;
+    }
+
+    if (workers > totalCount / MIN_RECORDS_PER_WORKER) {
+        workers = totalCount / MIN_RECORDS_PER_WORKER;
+    }
+    if (workers > 1) {
+        int status = saveRangesParallel(fp, fleet, totalCount, workers);
+        if (fclose(fp) != 0) {
+            status = -1;
+        }
+        return status;
+    }
+
+    OutBuf ob;
+    if (outInit(&ob, fp) != 0) {
+        printf("Error: memory allocation failed.\n");
+        fclose(fp);
+        return -1;
+    }
+    for (int i = 0; i < totalCount; i++) {
+        formatVesselRecord(&ob, fleet[i]);
+    }
+
+    int status = outFinish(&ob);
+    if (fclose(fp) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+/* Worker: format one range of the fleet into its own in-memory buffer */
+static void* formatRangeTask(void* arg)
+{
+    SaveRange* range = (SaveRange*)arg;
+    if (outInit(&range->out, NULL) == 0) {
+        for (int i = 0; i < range->count; i++) {
+            formatVesselRecord(&range->out, range->vessels[i]);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Split the sorted fleet into one contiguous range per worker, format the
+ * ranges concurrently, then write the buffers out in range order so the
+ * file keeps its name order.
+ */
+int saveRangesParallel(FILE* fp, Vessel** fleet, int totalCount, int workers)
+{
+    SaveRange ranges[MAX_WORKERS];
+    int       status = 0;
+    int       start  = 0;
+
+    for (int i = 0; i < workers; i++) {
+        int end = (int)((long long)totalCount * (i + 1) / workers);
+        ranges[i].vessels = fleet + start;
+        ranges[i].count   = end - start;
+        start = end;
+    }
+
+    runWorkers(workers, formatRangeTask, ranges, sizeof(SaveRange));
+
+    for (int i = 0; i < workers; i++) {
+        if (ranges[i].out.failed) {
+            status = -1;
+        } else if (status == 0 &&
+                   fwrite(ranges[i].out.data, 1, ranges[i].out.len, fp) != ranges[i].out.len) {
+            status = -1;
+        }
+        free(ranges[i].out.data);
+    }
+    if (status != 0) {
+        printf("Error: Could not write %d vessels in parallel.\n", totalCount);
+    }
+    return status;
+}
+
+/*
+ * Format one vessel as a CSV line, byte for byte what
+ * "%s,%.0f,%s,<detail>,%.2f\n" would produce
+ */
+void formatVesselRecord(OutBuf* ob, const Vessel* v)
+{
+    outBytes(ob, v->vesselName, v->nameLen);
+    outBytes(ob, ",", 1);
+    outFeet(ob, v->lengthHundredths, 0);
+    outBytes(ob, ",", 1);
+    outPadded(ob, locationCategoryToStr(v->locationCat), 0);
+    outBytes(ob, ",", 1);
+
+    switch (v->locationCat) {
+        case SLIP:
+            outInt(ob, v->locationInfo.slipNo, 0);
+            break;
+        case LAND:
+            outBytes(ob, &v->locationInfo.bayLabel, 1);
+            break;
+        case TRAILOR:
+            outPadded(ob, v->locationInfo.trailerTag, 0);
+            break;
+        case STORAGE:
+            outInt(ob, v->locationInfo.storageSpot, 0);
+            break;
+    }
+    outBytes(ob, ",", 1);
+    outCents(ob, v->outstandingFees, 0);
+    outBytes(ob, "\n", 1);
+}
+
+int outInit(OutBuf* ob, FILE* sink)
+{
+    ob->data   = (char*)malloc(OUTBUF_SIZE);
+    ob->len    = 0;
+    ob->cap    = OUTBUF_SIZE;
+    ob->sink   = sink;
+    ob->failed = ob->data == NULL;
+    return ob->failed ? -1 : 0;
+}
+
+/*
+ * Hand everything buffered so far to the sink
+ */
+void outFlush(OutBuf* ob)
+{
+    if (ob->sink && ob->len > 0) {
+        if (fwrite(ob->data, 1, ob->len, ob->sink) != ob->len) {
+            ob->failed = 1;
+        }
+        ob->len = 0;
+    }
+}
+
+/*
+ * Flush and release the buffer.  Returns -1 if anything failed along the
+ * way.
+ */
+int outFinish(OutBuf* ob)
+{
+    outFlush(ob);
+    if (ob->sink) {
+        fflush(ob->sink);
+    }
+    free(ob->data);
+    ob->data = NULL;
+    return ob->failed ? -1 : 0;
+}
+
+/* Make room for n more bytes, flushing or growing as needed */
+static int outReserve(OutBuf* ob, size_t n)
+{
+    if (ob->failed) {
+        return -1;
+    }
+    if (ob->len + n <= ob->cap) {
+        return 0;
+    }
+    outFlush(ob);
+    if (ob->len + n <= ob->cap) {
+        return 0;
+    }
+
+    size_t newCap = ob->cap;
+    while (newCap < ob->len + n) {
+        newCap *= 2;
+    }
+    char* grown = (char*)realloc(ob->data, newCap);
+    if (!grown) {
+        ob->failed = 1;
+        return -1;
+    }
+    ob->data = grown;
+    ob->cap  = newCap;
+    return 0;
+}
+
+void outBytes(OutBuf* ob, const char* bytes, size_t len)
+{
+    if (outReserve(ob, len) == 0) {
+        memcpy(ob->data + ob->len, bytes, len);
+        ob->len += len;
+    }
+}
+
+/* Append n copies of a byte */
+static void outFill(OutBuf* ob, char c, size_t n)
+{
+    if (outReserve(ob, n) == 0) {
+        memset(ob->data + ob->len, c, n);
+        ob->len += n;
+    }
+}
+
+/*
+ * Append a string padded to a field width like printf's %*s: a positive
+ * width right-aligns, a negative one left-aligns, and a longer string is
+ * never cut
+ */
+void outPadded(OutBuf* ob, const char* str, int width)
+{
+    size_t len = strlen(str);
+    size_t pad = 0;
+    if (width > 0 && (size_t)width > len) {
+        pad = (size_t)width - len;
+        outFill(ob, ' ', pad);
+    }
+    outBytes(ob, str, len);
+    if (width < 0 && (size_t)-width > len) {
+        outFill(ob, ' ', (size_t)-width - len);
+    }
+}
+
+/* Append digits right-aligned to width, as "%*d" would */
+static void outDigits(OutBuf* ob, int negative, uint64_t magnitude, int decimals, int width)
+{
+    char digits[32];
+    char text[40];
+    int  n   = 0;
+    int  len = 0;
+
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    while (n < decimals + 1) {
+        digits[n++] = '0';
+    }
+
+    if (negative) {
+        text[len++] = '-';
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        if (i == decimals - 1) {
+            text[len++] = '.';
+        }
+        text[len++] = digits[i];
+    }
+    if (width > len) {
+        outFill(ob, ' ', (size_t)(width - len));
+    }
+    outBytes(ob, text, (size_t)len);
+}
+
+void outInt(OutBuf* ob, long value, int width)
+{
+    uint64_t magnitude = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    outDigits(ob, value < 0, magnitude, 0, width);
+}
+
+/*
+ * Append cents as dollars with two decimals, as "%*.2f" prints money
+ */
+void outCents(OutBuf* ob, int64_t cents, int width)
+{
+    uint64_t magnitude = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+    outDigits(ob, cents < 0, magnitude, 2, width);
+}
+
+/*
+ * Append a length in hundredths as whole feet, rounding half to even as
+ * "%*.0f" does
+ */
+void outFeet(OutBuf* ob, int32_t hundredths, int width)
+{
+    uint64_t magnitude = hundredths < 0 ? 0 - (uint64_t)hundredths : (uint64_t)hundredths;
+    uint64_t feet      = magnitude / 100;
+    unsigned remainder = (unsigned)(magnitude % 100);
+    if (remainder > 50 || (remainder == 50 && (feet & 1))) {
+        feet++;
+    }
+    outDigits(ob, hundredths < 0 && feet > 0, feet, 0, width);
+}
+
+void columnsInit(FleetColumns* cols)
+{
+    memset(cols, 0, sizeof(*cols));
+}
+
+/*
+ * Make room for capacity records in every column, growing geometrically.
+ * Returns -1 when out of memory; columns already grown keep their size.
+ */
+int columnsReserve(FleetColumns* cols, int capacity)
+{
+    if (capacity <= cols->capacity) {
+        return 0;
+    }
+
+    int newCap = cols->capacity ? cols->capacity : FLEET_INITIAL_CAPACITY;
+    while (newCap < capacity) {
+        newCap = newCap > INT_MAX / 2 ? capacity : newCap * 2;
+    }
+    size_t n = (size_t)newCap;
+    int32_t*    lengths = (int32_t*)realloc(cols->lengthHundredths, n * sizeof(int32_t));
+    if (lengths) {
+        cols->lengthHundredths = lengths;
+    }
+    int64_t*    charges = (int64_t*)realloc(cols->monthlyCharge, n * sizeof(int64_t));
+    if (charges) {
+        cols->monthlyCharge = charges;
+    }
+    uint8_t*    cats    = (uint8_t*)realloc(cols->locationCat, n * sizeof(uint8_t));
+    if (cats) {
+        cols->locationCat = cats;
+    }
+    int64_t*    fees    = (int64_t*)realloc(cols->outstandingFees, n * sizeof(int64_t));
+    if (fees) {
+        cols->outstandingFees = fees;
+    }
+    LocDetails* details = (LocDetails*)realloc(cols->locationInfo, n * sizeof(LocDetails));
+    if (details) {
+        cols->locationInfo = details;
+    }
+    uint32_t*   offsets = (uint32_t*)realloc(cols->nameOffset, n * sizeof(uint32_t));
+    if (offsets) {
+        cols->nameOffset = offsets;
+    }
+    if (!lengths || !charges || !cats || !fees || !details || !offsets) {
+        return -1;
+    }
+    cols->capacity = newCap;
+    return 0;
+}
+
+/*
+ * Split a vessel record across the columns
+ */
+int columnsAppend(FleetColumns* cols, const Vessel* boat)
+{
+    size_t nameLen = boat->nameLen;
+
+    if (cols->count == INT_MAX || cols->nameBytes + nameLen + 1 > UINT32_MAX ||
+        columnsReserve(cols, cols->count + 1) != 0) {
+        return -1;
+    }
+    if (cols->nameBytes + nameLen + 1 > cols->nameCapacity) {
+        size_t newCap = cols->nameCapacity ? cols->nameCapacity : 4096;
+        while (newCap < cols->nameBytes + nameLen + 1) {
+            newCap *= 2;
+        }
+        char* grown = (char*)realloc(cols->names, newCap);
+        if (!grown) {
+            return -1;
+        }
+        cols->names        = grown;
+        cols->nameCapacity = newCap;
+    }
+
+    int i = cols->count++;
+    cols->lengthHundredths[i] = boat->lengthHundredths;
+    cols->monthlyCharge[i]   = monthlyChargeFor(boat);
+    cols->locationCat[i]     = (uint8_t)boat->locationCat;
+    cols->outstandingFees[i] = boat->outstandingFees;
+    cols->locationInfo[i]    = boat->locationInfo;
+    cols->nameOffset[i]      = (uint32_t)cols->nameBytes;
+    memcpy(cols->names + cols->nameBytes, boat->vesselName, nameLen);
+    cols->names[cols->nameBytes + nameLen] = '\0';
+    cols->nameBytes += nameLen + 1;
+    return 0;
+}
+
+/*
+ * Reassemble record idx, e.g. for formatting.  The name is borrowed from
+ * the columns.
+ */
+void columnsGet(const FleetColumns* cols, int idx, Vessel* boat)
+{
+    boat->vesselName      = columnsName(cols, idx);
+    boat->foldedName      = NULL;
+    boat->nameLen         = (uint32_t)strlen(boat->vesselName);
+    boat->lengthHundredths = cols->lengthHundredths[idx];
+    boat->locationCat     = (LocationCategory)cols->locationCat[idx];
+    boat->locationInfo    = cols->locationInfo[idx];
+    boat->outstandingFees = cols->outstandingFees[idx];
+}
+
+const char* columnsName(const FleetColumns* cols, int idx)
+{
+    return cols->names + cols->nameOffset[idx];
+}
+
+/* Empty the columns, keeping their storage for the next batch */
+void columnsClear(FleetColumns* cols)
+{
+    cols->count     = 0;
+    cols->nameBytes = 0;
+}
+
+void columnsFree(FleetColumns* cols)
+{
+    free(cols->lengthHundredths);
+    free(cols->monthlyCharge);
+    free(cols->locationCat);
+    free(cols->outstandingFees);
+    free(cols->locationInfo);
+    free(cols->nameOffset);
+    free(cols->names);
+    columnsInit(cols);
+}
+
+/*
+ * Copy a whole fleet into columns, keeping its name order
+ */
+int columnsFromFleet(FleetColumns* cols, Fleet* fleet)
+{
+    Vessel** vessels = fleetLiveVessels(fleet);
+
+    columnsClear(cols);
+    if (columnsReserve(cols, fleet->count) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < fleet->count; i++) {
+        if (columnsAppend(cols, vessels[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Billing kernels.  Each adds months of charges to count balances.  Every
+ * month's charge was rounded to whole cents when the columns were built,
+ * so the sums are exact in 64 bits and every kernel leaves the same
+ * balances behind.
+ */
+static void chargeRangeScalar(const int64_t* charges, int64_t* fees, int count, int months)
+{
+    for (int i = 0; i < count; i++) {
+        fees[i] += charges[i] * months;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * charge * months in each 64-bit lane.  There is no 64-bit multiply before
+ * AVX-512, so the charge's two halves are multiplied by months separately
+ * and the high product is shifted into place, which wraps exactly as the
+ * scalar multiply does.
+ */
+__attribute__((target("sse2")))
+static inline __m128i monthsOfCharges(__m128i charge, __m128i months)
+{
+    __m128i low  = _mm_mul_epu32(charge, months);
+    __m128i high = _mm_mul_epu32(_mm_srli_epi64(charge, 32), months);
+    return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i monthsOfCharges256(__m256i charge, __m256i months)
+{
+    __m256i low  = _mm256_mul_epu32(charge, months);
+    __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(charge, 32), months);
+    return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+}
+
+/* Two vessels per register, four per step */
+__attribute__((target("sse2")))
+static void chargeRangeSse2(const int64_t* charges, int64_t* fees, int count, int months)
+{
+    const __m128i perVessel = _mm_set1_epi64x(months);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i charge01 = _mm_loadu_si128((const __m128i*)(charges + i));
+        __m128i charge23 = _mm_loadu_si128((const __m128i*)(charges + i + 2));
+        __m128i owed01   = _mm_loadu_si128((const __m128i*)(fees + i));
+        __m128i owed23   = _mm_loadu_si128((const __m128i*)(fees + i + 2));
+        owed01 = _mm_add_epi64(owed01, monthsOfCharges(charge01, perVessel));
+        owed23 = _mm_add_epi64(owed23, monthsOfCharges(charge23, perVessel));
+        _mm_storeu_si128((__m128i*)(fees + i), owed01);
+        _mm_storeu_si128((__m128i*)(fees + i + 2), owed23);
+    }
+    chargeRangeScalar(charges + i, fees + i, count - i, months);
+}
+
+/* Four vessels per register, eight per step */
+__attribute__((target("avx2")))
+static void chargeRangeAvx2(const int64_t* charges, int64_t* fees, int count, int months)
+{
+    const __m256i perVessel = _mm256_set1_epi64x(months);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i chargeLo = _mm256_loadu_si256((const __m256i*)(charges + i));
+        __m256i chargeHi = _mm256_loadu_si256((const __m256i*)(charges + i + 4));
+        __m256i owedLo   = _mm256_loadu_si256((const __m256i*)(fees + i));
+        __m256i owedHi   = _mm256_loadu_si256((const __m256i*)(fees + i + 4));
+        owedLo = _mm256_add_epi64(owedLo, monthsOfCharges256(chargeLo, perVessel));
+        owedHi = _mm256_add_epi64(owedHi, monthsOfCharges256(chargeHi, perVessel));
+        _mm256_storeu_si256((__m256i*)(fees + i), owedLo);
+        _mm256_storeu_si256((__m256i*)(fees + i + 4), owedHi);
+    }
+    chargeRangeScalar(charges + i, fees + i, count - i, months);
+}
+#endif
+
+/* Billing kernel picked once at startup by initBillingKernel */
+static void (*chargeRange)(const int64_t* charges, int64_t* fees, int count,
+                           int months) = chargeRangeScalar;
+
+/*
+ * Choose the widest billing kernel this CPU supports
+ */
+void initBillingKernel()
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        chargeRange = chargeRangeAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        chargeRange = chargeRangeSse2;
+    }
+#endif
+}
+
+/* Worker: bill one partition and total what it charged */
+static void* billRangeTask(void* arg)
+{
+    BillingRange*  range  = (BillingRange*)arg;
+    BillingTotals* totals = &range->totals;
+
+    memset(totals, 0, sizeof(*totals));
+    if (range->vessels) {
+        for (int i = range->begin; i < range->end; i++) {
+            Vessel* v = range->vessels[i];
+            if (v->removed) {
+                continue;
+            }
+            int64_t charge = monthlyChargeFor(v) * range->months;
+            v->outstandingFees += charge;
+            totals->cents[v->locationCat]   += charge;
+            totals->vessels[v->locationCat] += 1;
+        }
+        return NULL;
+    }
+
+    FleetColumns* cols = range->columns;
+    chargeRange(cols->monthlyCharge + range->begin, cols->outstandingFees + range->begin,
+                range->end - range->begin, range->months);
+    for (int i = range->begin; i < range->end; i++) {
+        int cat = cols->locationCat[i];
+        totals->cents[cat]   += cols->monthlyCharge[i] * range->months;
+        totals->vessels[cat] += 1;
+    }
+    return NULL;
+}
+
+/*
+ * Bill [whole->begin, whole->end) split into one contiguous partition per
+ * worker, then add up the partitions' totals.  Each balance is updated by
+ * exactly one worker with the same arithmetic as a serial pass, and the
+ * totals are whole cents, so the result does not depend on the split.
+ */
+void billPartitioned(BillingRange* whole, int workers, BillingTotals* totals)
+{
+    BillingRange ranges[MAX_WORKERS];
+    int          count = whole->end - whole->begin;
+    int          start = whole->begin;
+
+    if (workers > count / MIN_RECORDS_PER_WORKER) {
+        workers = count / MIN_RECORDS_PER_WORKER;
+    }
+    if (workers < 1) {
+        workers = 1;
+    }
+    for (int i = 0; i < workers; i++) {
+        ranges[i]       = *whole;
+        ranges[i].begin = start;
+        ranges[i].end   = whole->begin + (int)((long long)count * (i + 1) / workers);
+        start           = ranges[i].end;
+    }
+
+    if (workers > 1) {
+        runWorkers(workers, billRangeTask, ranges, sizeof(BillingRange));
+    } else {
+        billRangeTask(&ranges[0]);
+    }
+
+    if (totals) {
+        memset(totals, 0, sizeof(*totals));
+        for (int i = 0; i < workers; i++) {
+            for (int cat = SLIP; cat <= STORAGE; cat++) {
+                totals->cents[cat]   += ranges[i].totals.cents[cat];
+                totals->vessels[cat] += ranges[i].totals.vessels[cat];
+            }
+        }
+    }
+}
+
+/*
+ * Add months of charges to every balance, on up to workers threads
+ */
+void chargeColumns(FleetColumns* cols, int months, int workers, BillingTotals* totals)
+{
+    BillingRange whole = { NULL, cols, 0, cols->count, months, { { 0 }, { 0 } } };
+    billPartitioned(&whole, workers, totals);
+}
+
+/*
+ * Bill every complete record in data[0, len) and write it to out.  The
+ * block is first split into columns, billed in one pass over them and then
+ * formatted, with unparsed lines copied back in their original places.
+ * Returns -1 when out of memory.
+ */
+static int billBlock(BillBatch* batch, const char* data, size_t len, int months, int workers,
+                     OutBuf* out, long* billed, long* passedThrough, BillingTotals* totals)
+{
+    FleetColumns* cols = &batch->columns;
+    StructScanner sc;
+    FieldSlice    field[5];
+    int           count;
+
+    columnsClear(cols);
+    batch->passedCount = 0;
+    scannerInit(&sc, data, len);
+    for (;;) {
+        size_t lineStart = sc.pos;
+        Vessel boat;
+
+        if ((count = scanRecord(&sc, field, 5)) < 0) {
+            break;
+        }
+        if (decodeVesselFields(field, count, &boat, 0) == PARSE_OK) {
+            if (columnsAppend(cols, &boat) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (batch->passedCount == batch->passedCapacity) {
+            int         newCap = batch->passedCapacity ? batch->passedCapacity * 2 : 64;
+            PassedLine* grown  = (PassedLine*)realloc(batch->passed, newCap * sizeof(PassedLine));
+            if (!grown) {
+                return -1;
+            }
+            batch->passed         = grown;
+            batch->passedCapacity = newCap;
+        }
+        PassedLine* passed = &batch->passed[batch->passedCount++];
+        passed->before     = cols->count;
+        passed->line.start = data + lineStart;
+        passed->line.len   = (sc.pos < len ? sc.pos : len) - lineStart;
+    }
+
+    BillingTotals blockTotals;
+    chargeColumns(cols, months, workers, &blockTotals);
+    for (int cat = SLIP; cat <= STORAGE; cat++) {
+        totals->cents[cat]   += blockTotals.cents[cat];
+        totals->vessels[cat] += blockTotals.vessels[cat];
+    }
+
+    int next = 0;
+    for (int i = 0; i <= cols->count; i++) {
+        for (; next < batch->passedCount && batch->passed[next].before == i; next++) {
+            FieldSlice line = batch->passed[next].line;
+            outBytes(out, line.start, line.len);
+            if (line.start + line.len == data + len &&
+                (line.len == 0 || line.start[line.len - 1] != '\n')) {
+                outBytes(out, "\n", 1);
+            }
+        }
+        if (i < cols->count) {
+            Vessel boat;
+            columnsGet(cols, i, &boat);
+            formatVesselRecord(out, &boat);
+        }
+    }
+    *billed        += cols->count;
+    *passedThrough += batch->passedCount;
+    return 0;
+}
+
+/*
+ * Month-end billing without loading the fleet.  The input is read in
+ * fixed-size blocks; each block's records are billed and written out
+ * before the next is read, so memory use does not depend on the file
+ * size.  Records keep their input order and lines that do not parse are
+ * copied through unchanged.  Each block is billed on up to workers
+ * threads and what was charged is added to totals.  The output goes to a
+ * temporary file renamed into place at the end, so outFile may be the
+ * input itself.  Returns the number of vessels billed,
+ * or -1 on error.
+ */
+long billStream(const char* inFile, const char* outFile, int months, int workers,
+                long* passedThrough, BillingTotals* totals)
+{
+    char journalPath[MAX_PATH_LEN];
+    char tempPath[MAX_PATH_LEN];
+    long billed = 0;
+
+    memset(totals, 0, sizeof(*totals));
+
+    snprintf(journalPath, sizeof(journalPath), "%s%s", inFile, JOURNAL_SUFFIX);
+    if (access(journalPath, F_OK) == 0) {
+        printf("Error: %s has unapplied journal entries; open it interactively first.\n",
+               inFile);
+        return -1;
+    }
+    if (isSnapshotFile(inFile)) {
+        printf("Error: streaming billing reads CSV data files only.\n");
+        return -1;
+    }
+
+    int in = open(inFile, O_RDONLY);
+    if (in < 0) {
+        printf("Error: Could not open %s for reading.\n", inFile);
+        return -1;
+    }
+#ifndef _WIN32
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", outFile);
+    FILE*  out   = fopen(tempPath, "w");
+    char*     block = (char*)malloc(STREAM_BLOCK_SIZE);
+    OutBuf    ob;
+    BillBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    if (!out || !block || outInit(&ob, out) != 0) {
+        printf("Error: Could not open file %s for writing.\n", tempPath);
+        if (out) {
+            fclose(out);
+            unlink(tempPath);
+        }
+        free(block);
+        close(in);
+        return -1;
+    }
+
+    size_t carry = 0;
+    for (;;) {
+        ssize_t got = read(in, block + carry, STREAM_BLOCK_SIZE - carry);
+        if (got < 0) {
+            billed = -1;
+            break;
+        }
+
+        /* Hold back a trailing partial line until the rest of it arrives */
+        size_t avail = carry + (size_t)got;
+        size_t limit = avail;
+        if (got > 0) {
+            while (limit > 0 && block[limit - 1] != '\n') {
+                limit--;
+            }
+            if (limit == 0) {
+                if (avail < STREAM_BLOCK_SIZE) {
+                    carry = avail;
+                    continue;
+                }
+                limit = avail;
+            }
+        }
+
+        if (billBlock(&batch, block, limit, months, workers, &ob, &billed,
+                      passedThrough, totals) != 0) {
+            printf("Error: memory allocation failed.\n");
+            billed = -1;
+            break;
+        }
+        carry = avail - limit;
+        memmove(block, block + limit, carry);
+        if (got == 0) {
+            break;
+        }
+    }
+    free(block);
+    columnsFree(&batch.columns);
+    free(batch.passed);
+    close(in);
+
+    if (outFinish(&ob) != 0) {
+        billed = -1;
+    }
+    if (fclose(out) != 0 || billed < 0) {
+        printf("Error: Could not bill %s.\n", inFile);
+        unlink(tempPath);
+        return -1;
+    }
+    if (rename(tempPath, outFile) != 0) {
+        printf("Error: Could not replace %s.\n", outFile);
+        unlink(tempPath);
+        return -1;
+    }
+    return billed;
+}
+
+/*
+ * Word-at-a-time FNV-style hash used to detect damaged snapshots
+ */
+uint64_t snapshotChecksum(const void* data, size_t len)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t             hash  = 0xCBF29CE484222325ULL;
+    size_t               i     = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+    }
+    for (; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/*
+ * Write the fleet as a binary snapshot.  The whole image is built in
+ * memory and written with a single call.
+ */
+int saveSnapshot(const char* fileName, Vessel** fleet, int totalCount)
+{
+    size_t nameBytes = 0;
+    for (int i = 0; i < totalCount; i++) {
+        if (fleet[i]->nameLen > UINT16_MAX) {
+            printf("Error: vessel name too long for a snapshot.\n");
+            return -1;
+        }
+        nameBytes += fleet[i]->nameLen;
+    }
+    if (nameBytes > UINT32_MAX) {
+        printf("Error: vessel names too large for a snapshot.\n");
+        return -1;
+    }
+
+    size_t bodySize = (size_t)totalCount * sizeof(SnapshotRecord) + nameBytes;
+    char*  image    = (char*)calloc(1, sizeof(SnapshotHeader) + bodySize);
+    if (!image) {
+        printf("Error: memory allocation failed.\n");
+        return -1;
+    }
+
+    SnapshotHeader* header  = (SnapshotHeader*)image;
+    SnapshotRecord* records = (SnapshotRecord*)(image + sizeof(SnapshotHeader));
+    char*           names   = (char*)(records + totalCount);
+    uint32_t        offset  = 0;
+
+    for (int i = 0; i < totalCount; i++) {
+        Vessel*         v   = fleet[i];
+        SnapshotRecord* rec = &records[i];
+        size_t          len = v->nameLen;
+
+        memcpy(names + offset, v->vesselName, len);
+        rec->nameOffset      = offset;
+        rec->nameLen         = (uint16_t)len;
+        rec->locationCat     = (uint8_t)v->locationCat;
+        rec->lengthHundredths = v->lengthHundredths;
+        rec->outstandingFees = v->outstandingFees;
+        switch (v->locationCat) {
+            case SLIP:
+                rec->locNumber = v->locationInfo.slipNo;
+                break;
+            case LAND:
+                rec->locText[0] = v->locationInfo.bayLabel;
+                break;
+            case TRAILOR:
+                strncpy(rec->locText, v->locationInfo.trailerTag, sizeof(rec->locText));
+                break;
+            case STORAGE:
+                rec->locNumber = v->locationInfo.storageSpot;
+                break;
+        }
+        offset += (uint32_t)len;
+    }
+
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version     = SNAPSHOT_VERSION;
+    header->recordSize  = sizeof(SnapshotRecord);
+    header->recordCount = (uint64_t)totalCount;
+    header->nameBytes   = nameBytes;
+    header->checksum    = snapshotChecksum(records, bodySize);
+
+    FILE* fp = fopen(fileName, "wb");
+    if (!fp) {
+        printf("Error: Could not open file %s for writing.\n", fileName);
+        free(image);
+        return -1;
+    }
+    int status = 0;
+    if (fwrite(image, 1, sizeof(SnapshotHeader) + bodySize, fp) != sizeof(SnapshotHeader) + bodySize) {
+        printf("Error: Could not write snapshot %s.\n", fileName);
+        status = -1;
+    }
+    if (fclose(fp) != 0) {
+        status = -1;
+    }
+    free(image);
+    return status;
+}
+
+/*
+ * Save the fleet in the chosen format
+ */
+int saveFleetFile(const char* fileName, SaveOptions options, Vessel** fleet, int totalCount)
+{
+    if (options.format == FORMAT_SNAPSHOT) {
+        return saveSnapshot(fileName, fleet, totalCount);
+    }
+    return saveData(fileName, fleet, totalCount, options.workers);
+}
+
+/*
+ * Replace the data file without ever leaving a half-written one: save to a
+ * temporary file, flush it to disk and rename it over the original.
+ */
+int saveFleetAtomic(const char* fileName, SaveOptions options, Vessel** fleet, int totalCount)
+{
+    char tempPath[MAX_PATH_LEN];
+
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", fileName);
+    if (saveFleetFile(tempPath, options, fleet, totalCount) != 0) {
+        unlink(tempPath);
+        return -1;
+    }
+
+    int fd = open(tempPath, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    if (rename(tempPath, fileName) != 0) {
+        printf("Error: Could not replace %s.\n", fileName);
+        unlink(tempPath);
+        return -1;
+    }
+    return 0;
+}
+
+void autoSaverInit(AutoSaver* saver)
+{
+    memset(saver, 0, sizeof(*saver));
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_cond_init(&saver->wake, NULL);
+}
+
+/*
+ * Copy the live records into the saver's buffer.  Called with lock held.
+ */
+static int captureFleet(AutoSaver* saver)
+{
+    Vessel** vessels = fleetLiveVessels(saver->fleet);
+    int      count   = saver->fleet->count;
+
+    if (count > saver->copyCapacity) {
+        Vessel*  copy  = (Vessel*)realloc(saver->copy, count * sizeof(Vessel));
+        if (copy) {
+            saver->copy = copy;
+        }
+        Vessel** index = (Vessel**)realloc(saver->copyIndex, count * sizeof(Vessel*));
+        if (index) {
+            saver->copyIndex = index;
+        }
+        if (!copy || !index) {
+            return -1;
+        }
+        saver->copyCapacity = count;
+    }
+    for (int i = 0; i < count; i++) {
+        settleVessel(saver->fleet, vessels[i]);
+        saver->copy[i]      = *vessels[i];
+        saver->copyIndex[i] = &saver->copy[i];
+    }
+    return count;
+}
+
+/* Saver thread: wake every interval and checkpoint if anything changed */
+static void* autoSaveTask(void* arg)
+{
+    AutoSaver* saver = (AutoSaver*)arg;
+
+    pthread_mutex_lock(&saver->lock);
+    while (!saver->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += saver->interval;
+        while (!saver->stopping &&
+               pthread_cond_timedwait(&saver->wake, &saver->lock, &deadline) == 0) {
+        }
+        if (saver->stopping || !saver->dirty) {
+            continue;
+        }
+
+        int count = captureFleet(saver);
+        if (count < 0) {
+            continue;
+        }
+        saver->dirty = 0;
+        pthread_mutex_unlock(&saver->lock);
+
+        int status = saveFleetAtomic(saver->fileName, saver->options, saver->copyIndex, count);
+
+        pthread_mutex_lock(&saver->lock);
+        if (status != 0) {
+            saver->dirty = 1;
+        }
+    }
+    pthread_mutex_unlock(&saver->lock);
+    return NULL;
+}
+
+int autoSaverStart(AutoSaver* saver, const char* fileName, SaveOptions options,
+                   Fleet* fleet, int interval)
+{
+    saver->fileName = fileName;
+    saver->options  = options;
+    saver->fleet    = fleet;
+    saver->interval = interval;
+    if (pthread_create(&saver->thread, NULL, autoSaveTask, saver) != 0) {
+        return -1;
+    }
+    saver->running = 1;
+    return 0;
+}
+
+/*
+ * Stop the saver thread, waiting for a checkpoint in progress to land
+ */
+void autoSaverStop(AutoSaver* saver)
+{
+    if (saver->running) {
+        pthread_mutex_lock(&saver->lock);
+        saver->stopping = 1;
+        pthread_cond_signal(&saver->wake);
+        pthread_mutex_unlock(&saver->lock);
+        pthread_join(saver->thread, NULL);
+        saver->running = 0;
+    }
+    free(saver->copy);
+    free(saver->copyIndex);
+    saver->copy         = NULL;
+    saver->copyIndex    = NULL;
+    saver->copyCapacity = 0;
+}
+
+/*
+ * Open the journal for appending.  A record torn by a crash is cut off so
+ * new entries start on a line of their own.
+ */
+int journalOpen(Journal* journal, const char* dataFile, long compactEvery)
+{
+    if (snprintf(journal->path, sizeof(journal->path), "%s%s",
+                 dataFile, JOURNAL_SUFFIX) >= (int)sizeof(journal->path)) {
+        return -1;
+    }
+    journal->fd = open(journal->path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal->fd < 0) {
+        return -1;
+    }
+
+    MappedFile mf;
+    if (mapDataFile(journal->path, &mf) == 0) {
+        size_t complete = mf.size;
+        while (complete > 0 && mf.data[complete - 1] != '\n') {
+            complete--;
+        }
+        if (complete != mf.size && ftruncate(journal->fd, (off_t)complete) != 0) {
+            unmapDataFile(&mf);
+            close(journal->fd);
+            journal->fd = -1;
+            return -1;
+        }
+        unmapDataFile(&mf);
+    }
+    journal->records      = 0;
+    journal->compactEvery = compactEvery;
+
+    struct stat st;
+    if (fstat(journal->fd, &st) == 0 && st.st_size == 0 && journalStamp(journal, dataFile) != 0) {
+        journalClose(journal);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Start an empty journal with the generation of the data file it will
+ * apply to
+ */
+int journalStamp(Journal* journal, const char* dataFile)
+{
+    char     line[32];
+    uint64_t sum;
+
+    if (dataFileChecksum(dataFile, &sum) != 0) {
+        return -1;
+    }
+    int len = snprintf(line, sizeof(line), "G,%016" PRIx64 "\n", sum);
+    if (write(journal->fd, line, (size_t)len) != len) {
+        printf("Warning: Could not write to journal %s.\n", journal->path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Checksum the contents of a data file; one that does not exist counts as
+ * empty.  Returns -1 if it cannot be read.
+ */
+int dataFileChecksum(const char* fileName, uint64_t* sum)
+{
+    MappedFile mf;
+    if (access(fileName, F_OK) != 0) {
+        *sum = snapshotChecksum(NULL, 0);
+        return 0;
+    }
+    if (mapDataFile(fileName, &mf) != 0) {
+        return -1;
+    }
+    *sum = snapshotChecksum(mf.data, mf.size);
+    unmapDataFile(&mf);
+    return 0;
+}
+
+void journalClose(Journal* journal)
+{
+    if (journal->fd >= 0) {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+}
+
+/*
+ * Append one entry.  Each entry is a single line handed to the kernel in
+ * one write, so it survives the process dying right afterwards.
+ */
+void journalRecord(Journal* journal, const char* format, ...)
+{
+    char    entry[512];
+    va_list args;
+
+    if (!journal || journal->fd < 0) {
+        return;
+    }
+    va_start(args, format);
+    int len = vsnprintf(entry, sizeof(entry) - 1, format, args);
+    va_end(args);
+    if (len < 0 || len >= (int)sizeof(entry) - 1) {
+        return;
+    }
+    entry[len++] = '\n';
+    if (write(journal->fd, entry, (size_t)len) != len) {
+        printf("Warning: Could not write to journal %s.\n", journal->path);
+        return;
+    }
+    journal->records++;
+}
+
+/*
+ * Re-apply the entries of an existing journal to the freshly loaded fleet.
+ * Only complete lines are applied.  A journal stamped for another
+ * generation of the data file was already folded into it, so it is
+ * deleted instead.  Returns the number of entries.
+ */
+long replayJournal(const char* dataFile, Fleet* fleet)
+{
+    char       path[MAX_PATH_LEN];
+    MappedFile mf;
+    long       applied = 0;
+
+    snprintf(path, sizeof(path), "%s%s", dataFile, JOURNAL_SUFFIX);
+    if (mapDataFile(path, &mf) != 0) {
+        return 0;
+    }
+
+    const char* cursor = mf.data;
+    const char* end    = mf.data + mf.size;
+    while (cursor < end) {
+        const char* newline = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!newline) {
+            break;
+        }
+
+        char   entry[512];
+        size_t len = (size_t)(newline - cursor);
+        if (len > sizeof(entry) - 1) {
+            len = sizeof(entry) - 1;
+        }
+        memcpy(entry, cursor, len);
+        entry[len] = '\0';
+        cursor = newline + 1;
+
+        char* arg = len > 2 ? entry + 2 : entry + len;
+        switch (entry[0]) {
+            case 'G': {
+                uint64_t sum;
+                if (dataFileChecksum(dataFile, &sum) == 0 && sum != strtoull(arg, NULL, 16)) {
+                    printf("Note: %s was already applied to %s; discarding it.\n", path,
+                           dataFile);
+                    unmapDataFile(&mf);
+                    unlink(path);
+                    return 0;
+                }
+                continue;
+            }
+            case 'A':
+                addVesselFromCsv(fleet, arg);
+                break;
+            case 'R': {
+                Vessel* boat = findVesselByName(fleet, arg);
+                if (boat) {
+                    fleetRemove(fleet, boat);
+                }
+                break;
+            }
+            case 'P': {
+                char* comma = strrchr(arg, ',');
+                if (!comma) {
+                    continue;
+                }
+                *comma = '\0';
+                FieldSlice amount = { comma + 1, strlen(comma + 1) };
+                int64_t    cents;
+                Vessel*    boat   = findVesselByName(fleet, arg);
+                if (boat && parseMoney(amount, &cents) == 0) {
+                    boat->outstandingFees -= cents;
+                }
+                break;
+            }
+            case 'M':
+                accrueMonth(fleet, 1);
+                break;
+            default:
+                continue;
+        }
+        applied++;
+    }
+    unmapDataFile(&mf);
+    return applied;
+}
+
+/*
+ * Fold the journal into the data file, emptying the journal only once the
+ * new data file is safely in place, and stamp it with the new file's
+ * generation.  Until then the old stamp keeps a crash from replaying the
+ * entries again.
+ */
+int compactJournal(Journal* journal, const char* dataFile, SaveOptions options,
+                   Vessel** fleet, int totalCount)
+{
+    if (saveFleetAtomic(dataFile, options, fleet, totalCount) != 0) {
+        return -1;
+    }
+    if (ftruncate(journal->fd, 0) != 0) {
+        printf("Warning: Could not truncate journal %s.\n", journal->path);
+        return -1;
+    }
+    journal->records = 0;
+    return journalStamp(journal, dataFile);
+}
+
+/*
+ * Check whether a file starts with the snapshot magic
+ */
+int isSnapshotFile(const char* fileName)
+{
+    char  magic[sizeof(SNAPSHOT_MAGIC) - 1];
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp) {
+        return 0;
+    }
+    int found = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return found;
+}
+
+/*
+ * Load a binary snapshot written by saveSnapshot.  The file is read in one
+ * go and rejected as a whole if its header or checksum do not match.  Returns 0 on success
+ * and -1 if the snapshot is damaged or does not fit in memory, so that
+ * it is never saved over with part of its fleet.
+ */
+int loadSnapshot(const char* fileName, Fleet* fleet)
+{
+    MappedFile     mf;
+    SnapshotHeader header;
+
+    if (mapDataFile(fileName, &mf) != 0) {
+        printf("Warning: Could not open %s for reading.\n", fileName);
+        return 0;
+    }
+    if (mf.size < sizeof(header)) {
+        unmapDataFile(&mf);
+        return -1;
+    }
+    memcpy(&header, mf.data, sizeof(header));
+
+    const SnapshotRecord* records  = (const SnapshotRecord*)(mf.data + sizeof(header));
+    size_t                bodySize = mf.size - sizeof(header);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION ||
+        header.recordSize != sizeof(SnapshotRecord) ||
+        header.recordCount > bodySize / sizeof(SnapshotRecord) ||
+        header.recordCount * sizeof(SnapshotRecord) + header.nameBytes != bodySize ||
+        snapshotChecksum(records, bodySize) != header.checksum) {
+        unmapDataFile(&mf);
+        return -1;
+    }
+    if (header.recordCount > INT_MAX || fleetReserve(fleet, (int)header.recordCount) != 0) {
+        printf("Error: memory allocation failed.\n");
+        unmapDataFile(&mf);
+        return -1;
+    }
+
+    const char* names  = (const char*)(records + header.recordCount);
+    int         sorted = 1;
+    for (uint64_t i = 0; i < header.recordCount; i++) {
+        const SnapshotRecord* rec = &records[i];
+        if (rec->locationCat > STORAGE ||
+            (uint64_t)rec->nameOffset + rec->nameLen > header.nameBytes) {
+            continue;
+        }
+
+        Vessel boat;
+        memset(&boat, 0, sizeof(boat));
+        boat.vesselName      = names + rec->nameOffset;
+        boat.nameLen         = rec->nameLen;
+        boat.lengthHundredths = rec->lengthHundredths;
+        boat.locationCat     = (LocationCategory)rec->locationCat;
+        boat.outstandingFees = rec->outstandingFees;
+        switch (boat.locationCat) {
+            case SLIP:
+                boat.locationInfo.slipNo = rec->locNumber;
+                break;
+            case LAND:
+                boat.locationInfo.bayLabel = rec->locText[0];
+                break;
+            case TRAILOR:
+                memcpy(boat.locationInfo.trailerTag, rec->locText, sizeof(rec->locText));
+                boat.locationInfo.trailerTag[sizeof(rec->locText) - 1] = '\0';
+                break;
+            case STORAGE:
+                boat.locationInfo.storageSpot = rec->locNumber;
+                break;
+        }
+
+        Vessel* newBoat = fleetAdd(fleet, &boat);
+        if (!newBoat) {
+            printf("Error: memory allocation failed.\n");
+            unmapDataFile(&mf);
+            return -1;
+        }
+        if (fleet->count > 1 && compareVessels(&fleet->vessels[fleet->count - 2], &newBoat) > 0) {
+            sorted = 0;
+        }
+    }
+    unmapDataFile(&mf);
+
+    /* Snapshots are written in name order; only re-sort one that is not */
+    if (!sorted) {
+        qsort(fleet->vessels, fleet->count, sizeof(Vessel*), compareVessels);
+    }
+    return fleetBuildOrder(fleet);
+}
+
+/* List vessels in alphabetical order */
+void listAllVessels(Fleet* fleet)
+{
+    OutBuf ob;
+    if (outInit(&ob, stdout) != 0) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+
+    /* Same columns as "%-20s %3.0f' %8s ...   Owes $%7.2f", walking the leaves in order */
+    for (TreeNode* leaf = fleet->order.first; leaf; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; i++) {
+            Vessel* v = leaf->vessels[i];
+            if (v->removed) {
+                continue;
+            }
+            settleVessel(fleet, v);
+            formatInventoryLine(&ob, v);
+        }
+    }
+    outBytes(&ob, "\n", 1);
+    outFinish(&ob);
+}
+
+/*
+ * One inventory line, in the same columns as
+ * "%-20s %3.0f' %8s ...   Owes $%7.2f"
+ */
+void formatInventoryLine(OutBuf* ob, const Vessel* v)
+{
+    outPadded(ob, v->vesselName, -20);
+    outBytes(ob, " ", 1);
+    outFeet(ob, v->lengthHundredths, 3);
+    outBytes(ob, "' ", 2);
+    outPadded(ob, locationCategoryToStr(v->locationCat), 8);
+
+    switch (v->locationCat) {
+        case SLIP:
+            outBytes(ob, "   # ", 5);
+            outInt(ob, v->locationInfo.slipNo, 2);
+            break;
+        case LAND:
+            outBytes(ob, "      ", 6);
+            outBytes(ob, &v->locationInfo.bayLabel, 1);
+            break;
+        case TRAILOR:
+            outBytes(ob, " ", 1);
+            outPadded(ob, v->locationInfo.trailerTag, 6);
+            break;
+        case STORAGE:
+            outBytes(ob, "   # ", 5);
+            outInt(ob, v->locationInfo.storageSpot, 2);
+            break;
+    }
+    outBytes(ob, "   Owes $", 9);
+    outCents(ob, v->outstandingFees, 7);
+    outBytes(ob, "\n", 1);
+}
+
+/*
+ * Find the boats whose names begin with prefix, ignoring case.  The
+ * names sit together in the tree's order, so this costs one descent plus
+ * a step per match.  A prefix too long for any input is cut short.
+ */
+void prefixSearchStart(const Fleet* fleet, const char* prefix, PrefixSearch* search)
+{
+    search->len = strlen(prefix);
+    if (search->len >= sizeof(search->folded)) {
+        search->len = sizeof(search->folded) - 1;
+    }
+    foldName(search->folded, prefix, search->len);
+    treeSeek(&fleet->order, search->folded, &search->at);
+}
+
+/*
+ * The next boat in name order that matches, or NULL when there are no
+ * more
+ */
+Vessel* prefixSearchNext(PrefixSearch* search)
+{
+    Vessel* v;
+    while ((v = treeNext(&search->at)) != NULL) {
+        if (strncmp(v->foldedName, search->folded, search->len) != 0) {
+            search->at.leaf = NULL;
+            return NULL;
+        }
+        if (!v->removed) {
+            return v;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * List every boat whose name begins with prefix
+ */
+void searchVessels(Fleet* fleet, const char* prefix)
+{
+    OutBuf ob;
+    if (outInit(&ob, stdout) != 0) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+    PrefixSearch search;
+    Vessel*      v;
+    int          found = 0;
+    prefixSearchStart(fleet, prefix, &search);
+    while ((v = prefixSearchNext(&search)) != NULL) {
+        settleVessel(fleet, v);
+        formatInventoryLine(&ob, v);
+        found++;
+    }
+    if (found == 0) {
+        static const char none[] = "No boat name starts with that\n";
+        outBytes(&ob, none, sizeof(none) - 1);
+    }
+    outBytes(&ob, "\n", 1);
+    outFinish(&ob);
+}
+
+/*
+ * Say no boat has name and suggest up to MAX_SUGGESTIONS that share as
+ * long a start with it as any boat does
+ */
+void reportNoSuchBoat(const Fleet* fleet, const char* name)
+{
+    printf("No boat with that name\n");
+
+    char   start[MAX_INPUT_LEN];
+    size_t len = strlen(name);
+    if (len >= sizeof(start)) {
+        len = sizeof(start) - 1;
+    }
+    memcpy(start, name, len);
+    for (; len > 0; len--) {
+        PrefixSearch search;
+        Vessel*      v;
+        int          shown = 0;
+
+        start[len] = '\0';
+        prefixSearchStart(fleet, start, &search);
+        while (shown < MAX_SUGGESTIONS && (v = prefixSearchNext(&search)) != NULL) {
+            printf("%s%s", shown ? ", " : "Did you mean: ", v->vesselName);
+            shown++;
+        }
+        if (shown > 0) {
+            printf("%s\n", prefixSearchNext(&search) ? ", ..." : "");
+            break;
+        }
+    }
+    printf("\n");
+}
+
+/*
+ * Report why typed-in boat data or a location was rejected.  Returns -1
+ * unless status is PARSE_OK.
+ */
+static int reportParseStatus(ParseStatus status)
+{
+    switch (status) {
+        case PARSE_OK:
+            return 0;
+        case PARSE_BAD_FORMAT:
+            printf("Error: Invalid CSV format.\n\n");
+            break;
+        case PARSE_INCOMPLETE:
+            printf("Error: Incomplete data.\n\n");
+            break;
+        case PARSE_UNKNOWN_LOCATION:
+            printf("Error: Unknown location.\n\n");
+            break;
+        case PARSE_MISSING_FEE:
+            printf("Error: Missing fee data.\n\n");
+            break;
+        case PARSE_BAD_NUMBER:
+            printf("Error: Invalid number.\n\n");
+            break;
+    }
+    return -1;
+}
+
+/*
+ * Parse a CSV-style boat typed in or journaled.  The name is borrowed from
+ * csvLine.  Given autoSpot, a slip or storage spot typed as "auto" is left
+ * as 0 for the caller to assign and autoSpot is set to the field; it is
+ * empty otherwise.  Problems are reported and give -1.
+ */
+static int parseVesselInput(const char* csvLine, Vessel* parsed, FieldSlice* autoSpot)
+{
+    static const char unassigned[] = "0";
+    StructScanner     sc;
+    FieldSlice        field[5];
+
+    scannerInit(&sc, csvLine, strlen(csvLine));
+    int count = scanRecord(&sc, field, 5);
+    if (autoSpot) {
+        autoSpot->start = NULL;
+        autoSpot->len   = 0;
+        /* Only slips and storage are numbered; other details may read "auto" */
+        int numbered = count >= 4 && (sliceEquals(field[2], "slip", 1) ||
+                                      sliceEquals(field[2], "storage", 1));
+        if (numbered && sliceEquals(field[3], "auto", 1)) {
+            *autoSpot      = field[3];
+            field[3].start = unassigned;
+            field[3].len   = 1;
+        }
+    }
+    return reportParseStatus(decodeVesselFields(field, count, parsed, 1));
+}
+
+/* Add a parsed boat in name order, reporting running out of memory */
+static Vessel* insertParsedVessel(Fleet* fleet, const Vessel* parsed)
+{
+    Vessel* newBoat = fleetInsert(fleet, parsed);
+    if (!newBoat) {
+        printf("Error: Memory allocation problem.\n\n");
+    }
+    return newBoat;
+}
+
+/*
+ * List the boats at a location, given as in a record, e.g. slip,42
+ */
+void locateVessels(Fleet* fleet, const char* query)
+{
+    StructScanner    sc;
+    FieldSlice       field[2];
+    LocationCategory cat;
+    LocDetails       where;
+
+    memset(&where, 0, sizeof(where));
+    scannerInit(&sc, query, strlen(query));
+    int count = scanRecord(&sc, field, 2);
+    if (reportParseStatus(count < 1 ? PARSE_BAD_FORMAT
+                                    : decodeLocationFields(field, count, &cat, &where, 1)) != 0) {
+        return;
+    }
+    if ((cat == SLIP && (where.slipNo < 1 || where.slipNo > MAX_SLIP_NUM)) ||
+        (cat == STORAGE && (where.storageSpot < 1 || where.storageSpot > MAX_STORAGE_LOC))) {
+        printf("Error: Slips are numbered 1 to %d and storage spots 1 to %d.\n\n",
+               MAX_SLIP_NUM, MAX_STORAGE_LOC);
+        return;
+    }
+
+    OutBuf ob;
+    if (outInit(&ob, stdout) != 0) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+    const LocationList* there = locationIndexFind(&fleet->locations, cat, &where);
+    if (!there || there->count == 0) {
+        static const char none[] = "No boat is at that location\n";
+        outBytes(&ob, none, sizeof(none) - 1);
+    } else {
+        for (Vessel* v = there->head; v; v = v->locNext) {
+            settleVessel(fleet, v);
+            formatInventoryLine(&ob, v);
+        }
+        if (locationIsExclusive(cat) && there->count > 1) {
+            static const char clash[] = "Warning: more than one boat claims this spot\n";
+            outBytes(&ob, clash, sizeof(clash) - 1);
+        }
+    }
+    outBytes(&ob, "\n", 1);
+    outFinish(&ob);
+}
+
+/*
+ * Print the numbers first to last whose bits are clear, as ranges, and
+ * how many there are
+ */
+static void printFreeRanges(const uint64_t* taken, int first, int last)
+{
+    int freeCount = 0;
+    for (int i = first; i <= last; i++) {
+        if (bitTest(taken, i)) {
+            continue;
+        }
+        int end = i;
+        while (end < last && !bitTest(taken, end + 1)) {
+            end++;
+        }
+        printf(freeCount ? ", %d" : " %d", i);
+        if (end > i) {
+            printf("-%d", end);
+        }
+        freeCount += end - i + 1;
+        i = end;
+    }
+    printf("%s (%d of %d free)\n", freeCount ? "" : " none", freeCount, last - first + 1);
+}
+
+/* Print each of the lists first to last that more than one boat is on */
+static void printClaims(const LocationList* lists, int first, int last, const char* what)
+{
+    for (int i = first; i <= last; i++) {
+        if (lists[i].count > 1) {
+            printf("  %s #%d is claimed by", what, i);
+            for (const Vessel* v = lists[i].head; v; v = v->locNext) {
+                printf("%s %s", v == lists[i].head ? "" : ",", v->vesselName);
+            }
+            printf("\n");
+        }
+    }
+}
+
+/*
+ * Show the free slips and storage spots, the bays and trailer tags in
+ * use, and every slip or storage spot claimed by more than one boat
+ */
+void showOccupancy(const Fleet* fleet)
+{
+    const LocationIndex* loc = &fleet->locations;
+
+    printf("Free slips          :");
+    printFreeRanges(loc->slipsTaken, 1, MAX_SLIP_NUM);
+    printf("Free storage spots  :");
+    printFreeRanges(loc->storageTaken, 1, MAX_STORAGE_LOC);
+    printf("Bays in use         :");
+    for (int bay = 0; bay < MAX_BAYS; bay++) {
+        if (bitTest(loc->baysTaken, bay)) {
+            printf(" %c", 'A' + bay);
+        }
+    }
+    printf("\nTrailer tags in use : %zu\n", loc->tagCount);
+    if (loc->conflicts > 0) {
+        printf("Claimed by more than one boat:\n");
+        printClaims(loc->slips, 1, MAX_SLIP_NUM, "slip");
+        printClaims(loc->storage, 1, MAX_STORAGE_LOC, "storage");
+    }
+    printf("\n");
+}
+
+/*
+ * Insert a new boat from a CSV-style string.  A slip or storage spot that
+ * another boat already has is refused; one given as "auto" becomes the
+ * lowest free one, and is journaled as the number it got.
+ */
+void insertVessel(Fleet* fleet, const char* csvLine, Journal* journal)
+{
+    Vessel     parsed;
+    FieldSlice autoSpot;
+    int        spot = 0;
+
+    if (parseVesselInput(csvLine, &parsed, &autoSpot) != 0) {
+        return;
+    }
+    if (autoSpot.start) {
+        spot = locationIndexFirstFree(&fleet->locations, parsed.locationCat);
+        if (spot == 0) {
+            printf("Error: No %s is free.\n\n",
+                   parsed.locationCat == SLIP ? "slip" : "storage spot");
+            return;
+        }
+        if (parsed.locationCat == SLIP) {
+            parsed.locationInfo.slipNo = spot;
+        } else {
+            parsed.locationInfo.storageSpot = spot;
+        }
+    }
+    if (locationIsExclusive(parsed.locationCat)) {
+        const LocationList* there = locationIndexFind(&fleet->locations, parsed.locationCat,
+                                                      &parsed.locationInfo);
+        if (there && there->count > 0) {
+            printf("Error: %s #%d is already taken by %s.\n\n",
+                   locationCategoryToStr(parsed.locationCat),
+                   parsed.locationCat == SLIP ? parsed.locationInfo.slipNo
+                                              : parsed.locationInfo.storageSpot,
+                   there->head->vesselName);
+            return;
+        }
+    }
+    if (!insertParsedVessel(fleet, &parsed)) {
+        return;
+    }
+    if (autoSpot.start) {
+        printf("Assigned %s #%d\n\n", locationCategoryToStr(parsed.locationCat), spot);
+        journalRecord(journal, "A,%.*s%d%s", (int)(autoSpot.start - csvLine), csvLine, spot,
+                      autoSpot.start + autoSpot.len);
+    } else {
+        journalRecord(journal, "A,%s", csvLine);
+    }
+}
+
+/*
+ * Parse a CSV-style boat and add it to the fleet in name order, wherever
+ * it is kept.  Problems are reported and give NULL.
+ */
+Vessel* addVesselFromCsv(Fleet* fleet, const char* csvLine)
+{
+    Vessel parsed;
+    if (parseVesselInput(csvLine, &parsed, NULL) != 0) {
+        return NULL;
+    }
+    return insertParsedVessel(fleet, &parsed);
+}
+
+/*
+ * Delete a boat entry by its name
+ */
+void removeVessel(Fleet* fleet, const char* name, Journal* journal)
+{
+    Vessel* boat = findVesselByName(fleet, name);
+    if (!boat) {
+        reportNoSuchBoat(fleet, name);
+        return;
+    }
+    journalRecord(journal, "R,%s", boat->vesselName);
+    fleetRemove(fleet, boat);
+}
+
+/*
+ * Accept a payment of amountText up to the total owed
+ */
+void recordPayment(Fleet* fleet, const char* name, const char* amountText, Journal* journal)
+{
+    FieldSlice entry = { amountText, strlen(amountText) };
+    int64_t    amount;
+    char       owed[32];
+    char       paid[32];
+
+    Vessel* boat = findVesselByName(fleet, name);
+    if (!boat) {
+        reportNoSuchBoat(fleet, name);
+        return;
+    }
+    if (parseMoney(entry, &amount) != 0) {
+        printf("Error: Invalid amount.\n\n");
+        return;
+    }
+    settleVessel(fleet, boat);
+    if (amount >= boat->outstandingFees) {
+        printf("That is more than the amount owed, $%s\n\n",
+               centsText(owed, sizeof(owed), boat->outstandingFees));
+        return;
+    }
+    boat->outstandingFees -= amount;
+    journalRecord(journal, "P,%s,%s", boat->vesselName, centsText(paid, sizeof(paid), amount));
+}
+
+/*
+ * Add monthly charges for each vessel
+ */
+void applyMonthlyFees(Fleet* fleet, int workers, Journal* journal)
+{
+    accrueMonth(fleet, workers);
+    journalRecord(journal, "M");
+    printf("\n");
+}
+
+/*
+ * Add one month's charge to every vessel's balance, on up to workers
+ * threads.  totals may be NULL.
+ */
+void chargeMonthlyFees(Fleet* fleet, int workers, BillingTotals* totals)
+{
+    BillingRange whole = { fleetVessels(fleet), NULL, 0, fleet->count, 1, { { 0 }, { 0 } } };
+    billPartitioned(&whole, workers, totals);
+}
+
+/*
+ * Bill one month: at once, or with deferred billing just by moving the
+ * fleet on a month, which takes constant time
+ */
+void accrueMonth(Fleet* fleet, int workers)
+{
+    if (fleet->deferBilling) {
+        fleet->billingEpoch++;
+    } else {
+        chargeMonthlyFees(fleet, workers, NULL);
+    }
+}
+
+/*
+ * Charge a vessel for the months billed since it was last settled
+ */
+void settleVessel(const Fleet* fleet, Vessel* v)
+{
+    uint32_t months = fleet->billingEpoch - v->settledEpoch;
+    if (months != 0) {
+        v->outstandingFees += monthlyChargeFor(v) * (int64_t)months;
+        v->settledEpoch     = fleet->billingEpoch;
+    }
+}
+
+/*
+ * Bring every balance up to date, e.g. before the fleet is written out
+ */
+void settleFleet(Fleet* fleet)
+{
+    if (!fleet->deferBilling) {
+        return;
+    }
+    Vessel** vessels = fleetVessels(fleet);
+    for (int i = 0; i < fleet->count; i++) {
+        if (!vessels[i]->removed) {
+            settleVessel(fleet, vessels[i]);
+        }
+    }
+}
+
+/*
+ * One month's charge for a vessel at its category's rate, in cents
+ */
+int64_t monthlyChargeFor(const Vessel* v)
+{
+    int64_t rate = 0;
+    switch (v->locationCat) {
+        case SLIP:
+            rate = RATE_SLIP;
+            break;
+        case LAND:
+            rate = RATE_LAND;
+            break;
+        case TRAILOR:
+            rate = RATE_TRAILER;
+            break;
+        case STORAGE:
+            rate = RATE_STORAGE;
+            break;
+    }
+    return ((int64_t)v->lengthHundredths * rate + 50) / 100;
+}
+
+/*
+ * Convert the enum to a string
+ */
+char* locationCategoryToStr(LocationCategory lc)
+{
+    switch (lc) {
+        case SLIP:    return "slip";
+        case LAND:    return "land";
+        case TRAILOR: return "trailor";
+        case STORAGE: return "storage";
+        default:      return "unknown";
+    }
+}
+
+/*
+ * Find a boat by name, ignoring case, through the name index
+ */
+Vessel* findVesselByName(const Fleet* fleet, const char* searchName)
+{
+    char   buf[MAX_INPUT_LEN];
+    size_t len    = strlen(searchName);
+    char*  folded = len < sizeof(buf) ? buf : (char*)malloc(len + 1);
+
+    if (!folded) {
+        return NULL;
+    }
+    foldName(folded, searchName, len);
+    Vessel* boat = nameIndexFind(&fleet->index, folded, len);
+    if (folded != buf) {
+        free(folded);
+    }
+    return boat;
+}
+
+/*
+ * Used by qsort to compare names, through their folded copies
+ */
+int compareVessels(const void* a, const void* b)
+{
+    Vessel* va = *(Vessel**)a;
+    Vessel* vb = *(Vessel**)b;
+    return strcmp(va->foldedName, vb->foldedName);
+}
+
+/*
+ * Free up all dynamically allocated memory
+ */
+void freeVesselMemory(Fleet* fleet)
+{
+    poolRelease(&fleet->pool);
+    namePoolRelease(&fleet->names);
+    nameIndexFree(&fleet->index);
+    locationIndexFree(&fleet->locations);
+    treeFree(&fleet->order);
+    free(fleet->vessels);
+    fleetInit(fleet);
+}
+
+/*
+ * Monotonic wall clock in seconds, used for throughput reporting
+ */
+double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Print how fast a load or save went, based on the file's size on disk
+ */
+void reportThroughput(const char* action, const char* fileName, int count, double seconds)
+{
+    struct stat st;
+    double      megabytes = 0.0;
+    if (stat(fileName, &st) == 0) {
+        megabytes = (double)st.st_size / (1024.0 * 1024.0);
+    }
+    printf("%s %d vessels (%.2f MB) in %.3f ms, %.1f MB/s\n",
+           action, count, megabytes, seconds * 1000.0,
+           seconds > 0.0 ? megabytes / seconds : 0.0);
+}
+
+/*
+ * Cycle counter for the benchmarks.  Counts nanoseconds where there is no
+ * time-stamp counter.
+ */
+uint64_t readCycles()
+{
+#ifdef HAVE_X86_SIMD
+    return __rdtsc();
+#else
+    return (uint64_t)(nowSeconds() * 1e9);
+#endif
+}
+
+static uint64_t benchRandom(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+ * Build a CSV image of rows plausible boats with unique names.  The same
+ * rows come out on every run, so benchmark results are comparable.
+ */
+char* generateSyntheticFleet(long rows, size_t* outLen)
+{
+    static const char* words[] = { "Sea", "Wind", "Blue", "Lady", "Star", "Wave",
+                                   "Gull", "Knot", "Reef", "Tide", "Salt", "Fox" };
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    size_t   cap   = (size_t)rows * 64 + 1;
+    size_t   len   = 0;
+    char*    buf   = (char*)malloc(cap);
+
+    if (!buf) {
+        *outLen = 0;
+        return NULL;
+    }
+    for (long i = 0; i < rows; i++) {
+        uint64_t r      = benchRandom(&state);
+        int      length = 10 + (int)(r % 90);
+        long     fees   = (long)((r >> 8) % 500000);
+        char     detail[16];
+
+        switch ((r >> 32) % 4) {
+            case SLIP:
+                snprintf(detail, sizeof(detail), "slip,%d", 1 + (int)((r >> 40) % MAX_SLIP_NUM));
+                break;
+            case LAND:
+                snprintf(detail, sizeof(detail), "land,%c", 'A' + (int)((r >> 40) % 26));
+                break;
+            case TRAILOR:
+                snprintf(detail, sizeof(detail), "trailor,T%d", (int)((r >> 40) % 100000));
+                break;
+            default:
+                snprintf(detail, sizeof(detail), "storage,%d", 1 + (int)((r >> 40) % MAX_STORAGE_LOC));
+                break;
+        }
+        len += (size_t)snprintf(buf + len, cap - len, "%s%s%ld,%d,%s,%ld.%02ld\n",
+                                words[(r >> 48) % 12], words[(r >> 56) % 12], i,
+                                length, detail, fees / 100, fees % 100);
+    }
+    *outLen = len;
+    return buf;
+}
+
+/* Field splitting as loadData used to do it: copy the line, then strtok_r */
+static long scanWithStrtok(const char* data, size_t len)
+{
+    const char* cursor = data;
+    const char* end    = data + len;
+    long        fields = 0;
+    char        line[256];
+
+    while (cursor < end) {
+        const char* newline = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        size_t      n       = (size_t)((newline ? newline : end) - cursor);
+
+        if (n > sizeof(line) - 1) {
+            n = sizeof(line) - 1;
+        }
+        memcpy(line, cursor, n);
+        line[n] = '\0';
+
+        char* rest = line;
+        for (int i = 0; i < 5 && strtok_r(rest, ",", &rest) != NULL; i++) {
+            fields++;
+        }
+        cursor += n + 1;
+    }
+    return fields;
+}
+
+static long scanWithScanner(const char* data, size_t len)
+{
+    StructScanner sc;
+    FieldSlice    field[5];
+    long          fields = 0;
+    int           count;
+
+    scannerInit(&sc, data, len);
+    while ((count = scanRecord(&sc, field, 5)) >= 0) {
+        fields += count;
+    }
+    return fields;
+}
+
+static void reportScan(const char* label, size_t bytes, long fields,
+                       uint64_t cycles, double seconds)
+{
+    printf("%-10s %8.3f bytes/cycle %10.1f MB/s   %ld fields\n", label,
+           cycles ? (double)bytes / (double)cycles : 0.0,
+           seconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0,
+           fields);
+}
+
+/*
+ * Compare the strtok_r field splitter with the structural scanner using
+ * each block kernel the CPU supports
+ */
+static void benchScanner(long rows)
+{
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+    printf("Field scanning, %ld rows, %.1f MB\n", rows, (double)len / (1024.0 * 1024.0));
+
+    double   t0     = nowSeconds();
+    uint64_t c0     = readCycles();
+    long     fields = scanWithStrtok(data, len);
+    reportScan("strtok_r", len, fields, readCycles() - c0, nowSeconds() - t0);
+
+    struct {
+        const char* label;
+        uint64_t (*kernel)(const char*);
+        int         usable;
+    } kernels[] = {
+        { "scalar", structuralMaskScalar, 1 },
+#ifdef HAVE_X86_SIMD
+        { "sse2",   structuralMaskSse2,   __builtin_cpu_supports("sse2") },
+        { "avx2",   structuralMaskAvx2,   __builtin_cpu_supports("avx2") },
+#endif
+    };
+    uint64_t (*selected)(const char*) = structuralMask;
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (!kernels[k].usable) {
+            continue;
+        }
+        structuralMask = kernels[k].kernel;
+        t0     = nowSeconds();
+        c0     = readCycles();
+        fields = scanWithScanner(data, len);
+        reportScan(kernels[k].label, len, fields, readCycles() - c0, nowSeconds() - t0);
+    }
+    structuralMask = selected;
+    free(data);
+}
+
+/*
+ * Convert every numeric field of the synthetic fleet with atof/atoi (after
+ * copying each field out, as the loaders used to) and with the dedicated
+ * parsers.  Both sum lengths in hundredths and money in cents, so the
+ * checksums show they produced the same values.
+ */
+static void benchNumberParsing(long rows)
+{
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+
+    /* Gather the numeric fields once so only conversion is timed */
+    FieldSlice* numbers = (FieldSlice*)malloc((size_t)rows * 3 * sizeof(FieldSlice));
+    char*       kinds   = (char*)malloc((size_t)rows * 3);
+    long        count   = 0;
+    if (!numbers || !kinds) {
+        printf("Error: memory allocation failed.\n");
+        free(numbers);
+        free(kinds);
+        free(data);
+        return;
+    }
+
+    StructScanner sc;
+    FieldSlice    field[5];
+    scannerInit(&sc, data, len);
+    while (scanRecord(&sc, field, 5) == 5) {
+        numbers[count] = field[1];
+        kinds[count++] = 'd';
+        if (field[2].start[0] == 's') {
+            numbers[count] = field[3];
+            kinds[count++] = 'i';
+        }
+        numbers[count] = field[4];
+        kinds[count++] = 'm';
+    }
+    printf("Number parsing, %ld rows, %ld numeric fields\n", rows, count);
+
+    int64_t sumLibc = 0;
+    double  t0      = nowSeconds();
+    for (long i = 0; i < count; i++) {
+        char numBuf[32];
+        sliceToBuffer(numbers[i], numBuf, sizeof(numBuf));
+        if (kinds[i] == 'i') {
+            sumLibc += atoi(numBuf);
+        } else {
+            sumLibc += (int64_t)(atof(numBuf) * 100.0 + 0.5);
+        }
+    }
+    double libcSeconds = nowSeconds() - t0;
+
+    int64_t sumFast = 0;
+    long    errors  = 0;
+    t0 = nowSeconds();
+    for (long i = 0; i < count; i++) {
+        int64_t value;
+        int     n;
+        if (kinds[i] == 'd') {
+            errors += parseFixed(numbers[i], 2, &value) != 0;
+            sumFast += value;
+        } else if (kinds[i] == 'i') {
+            errors += parseWholeNumber(numbers[i], &n) != 0;
+            sumFast += n;
+        } else {
+            errors += parseMoney(numbers[i], &value) != 0;
+            sumFast += value;
+        }
+    }
+    double fastSeconds = nowSeconds() - t0;
+
+    printf("%-10s %8.2f ns/field %10.1f Mfields/s   checksum %" PRId64 "\n", "atof/atoi",
+           libcSeconds * 1e9 / (double)count, (double)count / libcSeconds / 1e6, sumLibc);
+    printf("%-10s %8.2f ns/field %10.1f Mfields/s   checksum %" PRId64 " (%ld rejected)\n",
+           "dedicated", fastSeconds * 1e9 / (double)count, (double)count / fastSeconds / 1e6,
+           sumFast, errors);
+
+    free(numbers);
+    free(kinds);
+    free(data);
+}
+
+/*
+ * Grow fleets of rows/100, rows/10 and rows vessels and time appending,
+ * loading and saving each one.  The per-vessel cost should stay flat as
+ * the fleet grows; a rising figure points at a step that is not linear.
+ */
+static void benchFleet(long rows)
+{
+    printf("Fleet growth, cost per vessel\n");
+    printf("%10s %12s %12s %12s\n", "vessels", "append ns", "load ns", "save ns");
+
+    for (long size = rows / 100 > 0 ? rows / 100 : rows; size <= rows; size *= 10) {
+        size_t len;
+        char*  data = generateSyntheticFleet(size, &len);
+        Fleet  fleet;
+        if (!data) {
+            printf("Error: memory allocation failed.\n");
+            return;
         }
-    } while (userChoice != 'X');
 
-    saveData(argv[1], fleet, totalVessels);
+        /* Appends from empty, paying for every doubling along the way */
+        Vessel template;
+        memset(&template, 0, sizeof(template));
+        template.vesselName = "Template";
+        template.nameLen    = 8;
+        fleetInit(&fleet);
+        double t0 = nowSeconds();
+        for (long i = 0; i < size && fleetAdd(&fleet, &template); i++) {
+        }
+        double appendSeconds = nowSeconds() - t0;
+        freeVesselMemory(&fleet);
 
-    printFarewell();
+        t0 = nowSeconds();
+        loadFleetBuffer(&fleet, data, len);
+        double loadSeconds = nowSeconds() - t0;
+        free(data);
 
-    /* Free memory */
-    freeVesselMemory(fleet, totalVessels);
+        OutBuf ob;
+        FILE*  fp = tmpfile();
+        t0 = nowSeconds();
+        if (fp && outInit(&ob, fp) == 0) {
+            for (int i = 0; i < fleet.count; i++) {
+                formatVesselRecord(&ob, fleet.vessels[i]);
+            }
+            outFinish(&ob);
+        }
+        double saveSeconds = nowSeconds() - t0;
+        if (fp) {
+            fclose(fp);
+        }
 
-    return 0;
+        printf("%10d %12.1f %12.1f %12.1f\n", fleet.count,
+               appendSeconds * 1e9 / (double)size, loadSeconds * 1e9 / (double)size,
+               saveSeconds * 1e9 / (double)size);
+        freeVesselMemory(&fleet);
+    }
 }
-void printWelcome()
+
+/* Sum the fees through the pointer array, as the billing and save passes walk it */
+static int64_t sumFees(Vessel** vessels, long count)
 {
-    printf("\nWelcome to Alans' Boat Management\n");
-    printf("--------------------------------------------\n\n");
+    int64_t total = 0;
+    for (long i = 0; i < count; i++) {
+        total += vessels[i]->outstandingFees;
+    }
+    return total;
 }
 
-void printFarewell()
+/*
+ * Allocate rows records one malloc at a time and from a VesselPool, then
+ * time a pass over them and tearing them down
+ */
+static void benchAllocator(long rows)
 {
-    printf("\nExiting Boat Management System\n");
+    Vessel** vessels = (Vessel**)malloc((size_t)rows * sizeof(Vessel*));
+    if (!vessels) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+    Vessel template;
+    memset(&template, 0, sizeof(template));
+    template.outstandingFees = 100;
+
+    printf("Vessel allocation, %ld records, ns per record\n", rows);
+    printf("%-10s %10s %10s %10s %12s\n", "allocator", "alloc", "scan", "free", "checksum");
+
+    long   made = 0;
+    double t0   = nowSeconds();
+    for (; made < rows; made++) {
+        vessels[made] = (Vessel*)malloc(sizeof(Vessel));
+        if (!vessels[made]) {
+            break;
+        }
+        *vessels[made] = template;
+    }
+    double allocSeconds = nowSeconds() - t0;
+    t0 = nowSeconds();
+    int64_t total = sumFees(vessels, made);
+    double scanSeconds = nowSeconds() - t0;
+    t0 = nowSeconds();
+    for (long i = 0; i < made; i++) {
+        free(vessels[i]);
+    }
+    double freeSeconds = nowSeconds() - t0;
+    printf("%-10s %10.1f %10.1f %10.1f %12" PRId64 "\n", "malloc",
+           allocSeconds * 1e9 / (double)rows,
+           scanSeconds * 1e9 / (double)rows, freeSeconds * 1e9 / (double)rows, total);
+
+    VesselPool pool;
+    poolInit(&pool);
+    t0 = nowSeconds();
+    for (made = 0; made < rows; made++) {
+        vessels[made] = poolAlloc(&pool);
+        if (!vessels[made]) {
+            break;
+        }
+        *vessels[made] = template;
+    }
+    allocSeconds = nowSeconds() - t0;
+    t0 = nowSeconds();
+    total = sumFees(vessels, made);
+    scanSeconds = nowSeconds() - t0;
+    t0 = nowSeconds();
+    poolRelease(&pool);
+    freeSeconds = nowSeconds() - t0;
+    printf("%-10s %10.1f %10.1f %10.1f %12" PRId64 "\n", "pool",
+           allocSeconds * 1e9 / (double)rows,
+           scanSeconds * 1e9 / (double)rows, freeSeconds * 1e9 / (double)rows, total);
+
+    free(vessels);
 }
 
-void showMenu()
+#define BENCH_BILLING_PASSES 10
+#define BILLING_COLUMN_BYTES (sizeof(int64_t) + sizeof(uint8_t) + sizeof(int64_t))
+
+static void reportBilling(const char* label, long count, size_t bytesPerVessel,
+                          double seconds, int64_t checksum)
 {
-    printf("(I)nventory, (A)dd, (R)emove, (P)ayment, (M)onth, e(X)it : ");
+    double vessels = (double)count * BENCH_BILLING_PASSES;
+    printf("%-10s %8.2f ns/vessel %8.1f Mvessels/s %6.2f GB/s (%3zu bytes/vessel)"
+           "   checksum %" PRId64 "\n", label, seconds * 1e9 / vessels, vessels / seconds / 1e6,
+           (double)bytesPerVessel * vessels / seconds / 1e9, bytesPerVessel, checksum);
 }
 
-void loadData(const char* fileName, Vessel** fleet, int* totalCount)
+/*
+ * Time monthly billing over the name-ordered record pointers and over the
+ * columnar copy of the same fleet with each billing kernel the CPU
+ * supports.  Bandwidth counts the bytes each layout has to bring in per
+ * vessel; the checksums show every pass billed the same.
+ */
+static void benchBilling(long rows, int workers)
 {
-    FILE* fp = fopen(fileName, "r");
-    if (!fp) {
-        printf("Warning: Could not open %s for reading.\n", fileName);
+    size_t       len;
+    char*        data = generateSyntheticFleet(rows, &len);
+    Fleet        fleet;
+    FleetColumns cols;
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
         return;
     }
+    fleetInit(&fleet);
+    columnsInit(&cols);
+    loadFleetBuffer(&fleet, data, len);
+    free(data);
+    if (columnsFromFleet(&cols, &fleet) != 0) {
+        printf("Error: memory allocation failed.\n");
+        freeVesselMemory(&fleet);
+        columnsFree(&cols);
+        return;
+    }
+    printf("Monthly billing, %d vessels, %d passes\n", fleet.count, BENCH_BILLING_PASSES);
 
-    *totalCount = 0;
-    char line[256];
-
-    while (fgets(line, sizeof(line), fp) != NULL && *totalCount < MAX_VESSELS) {
-        line[strcspn(line, "\n")] = '\0';  /* Remove trailing newline */
+    double t0 = nowSeconds();
+    for (int pass = 0; pass < BENCH_BILLING_PASSES; pass++) {
+        chargeMonthlyFees(&fleet, 1, NULL);
+    }
+    double  seconds  = nowSeconds() - t0;
+    int64_t checksum = 0;
+    for (int i = 0; i < fleet.count; i++) {
+        checksum += fleet.vessels[i]->outstandingFees;
+    }
+    reportBilling("records", fleet.count, sizeof(Vessel*) + sizeof(Vessel), seconds, checksum);
 
-        Vessel* newBoat = (Vessel*)malloc(sizeof(Vessel));
-        if (!newBoat) {
-            printf("Error: memory allocation failed.\n");
-            continue;
-        }
+    int64_t* startingFees = (int64_t*)malloc((size_t)cols.count * sizeof(int64_t) + 1);
+    if (!startingFees) {
+        printf("Error: memory allocation failed.\n");
+        freeVesselMemory(&fleet);
+        columnsFree(&cols);
+        return;
+    }
+    memcpy(startingFees, cols.outstandingFees, (size_t)cols.count * sizeof(int64_t));
 
-        char* segment;
-        char* remainder = line;
+    struct {
+        const char* label;
+        void (*kernel)(const int64_t*, int64_t*, int, int);
+        int         usable;
+    } kernels[] = {
+        { "scalar", chargeRangeScalar, 1 },
+#ifdef HAVE_X86_SIMD
+        { "sse2",   chargeRangeSse2,   __builtin_cpu_supports("sse2") },
+        { "avx2",   chargeRangeAvx2,   __builtin_cpu_supports("avx2") },
+#endif
+    };
+    void (*selected)(const int64_t*, int64_t*, int, int) = chargeRange;
 
-        segment = strtok_r(remainder, ",", &remainder);
-        if (!segment) {
-            free(newBoat);
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (!kernels[k].usable) {
             continue;
         }
-        strncpy(newBoat->vesselName, segment, MAX_VESSEL_NAME_LEN - 1);
-        newBoat->vesselName[MAX_VESSEL_NAME_LEN - 1] = '\0';
-
-        /* Length of vessel */
-        segment = strtok_r(remainder, ",", &remainder);
-        if (!segment) {
-            free(newBoat);
-            continue;
+        chargeRange = kernels[k].kernel;
+        memcpy(cols.outstandingFees, startingFees, (size_t)cols.count * sizeof(int64_t));
+        t0 = nowSeconds();
+        for (int pass = 0; pass < BENCH_BILLING_PASSES; pass++) {
+            chargeColumns(&cols, 1, 1, NULL);
+        }
+        seconds  = nowSeconds() - t0;
+        checksum = 0;
+        for (int i = 0; i < cols.count; i++) {
+            checksum += cols.outstandingFees[i];
         }
-        newBoat->lengthFt = (float)atof(segment);
+        reportBilling(kernels[k].label, cols.count, BILLING_COLUMN_BYTES, seconds, checksum);
+    }
+    chargeRange = selected;
 
-        /* Location category (slip land, trailor, storage) */
-        segment = strtok_r(remainder, ",", &remainder);
-        if (!segment) {
-            free(newBoat);
-            continue;
+    /* The same passes split across -j threads, with per-category totals */
+    if (workers > 1) {
+        BillingTotals totals;
+        char          label[32];
+
+        memcpy(cols.outstandingFees, startingFees, (size_t)cols.count * sizeof(int64_t));
+        t0 = nowSeconds();
+        for (int pass = 0; pass < BENCH_BILLING_PASSES; pass++) {
+            chargeColumns(&cols, 1, workers, &totals);
         }
-        if (strcmp(segment, "slip") == 0) {
-            newBoat->locationCat = SLIP;
-            segment = strtok_r(remainder, ",", &remainder);
-            if (!segment) {
-                free(newBoat);
-                continue;
-            }
-            newBoat->locationInfo.slipNo = atoi(segment);
-        } else if (strcmp(segment, "land") == 0) {
-            newBoat->locationCat = LAND;
-            segment = strtok_r(remainder, ",", &remainder);
-            if (!segment || strlen(segment) == 0) {
-                free(newBoat);
-                continue;
-            }
-            newBoat->locationInfo.bayLabel = segment[0];
-        } else if (strcmp(segment, "trailor") == 0) {
-            newBoat->locationCat = TRAILOR;
-            segment = strtok_r(remainder, ",", &remainder);
-            if (!segment) {
-                free(newBoat);
-                continue;
-            }
-            strncpy(newBoat->locationInfo.trailerTag, segment, 9);
-            newBoat->locationInfo.trailerTag[9] = '\0';
-        } else if (strcmp(segment, "storage") == 0) {
-            newBoat->locationCat = STORAGE;
-            segment = strtok_r(remainder, ",", &remainder);
-            if (!segment) {
-                free(newBoat);
-                continue;
-            }
-            newBoat->locationInfo.storageSpot = atoi(segment);
-        } else {
-            free(newBoat);
-            continue;
+        seconds  = nowSeconds() - t0;
+        checksum = 0;
+        for (int i = 0; i < cols.count; i++) {
+            checksum += cols.outstandingFees[i];
         }
+        snprintf(label, sizeof(label), "%d threads", workers);
+        reportBilling(label, cols.count, BILLING_COLUMN_BYTES, seconds, checksum);
+        printBillingTotals(&totals);
+    }
 
-        /* Outstanding fees */
-        segment = strtok_r(remainder, ",", &remainder);
-        if (!segment) {
-            free(newBoat);
-            continue;
-        }
-        newBoat->outstandingFees = (float)atof(segment);
+    free(startingFees);
+    freeVesselMemory(&fleet);
+    columnsFree(&cols);
+}
+
+#define BENCH_INSERT_ADDS    1000
 
-        fleet[*totalCount] = newBoat;
-        (*totalCount)++;
+/* Check vessels are in name order */
+static int vesselsSorted(Vessel** vessels, int count)
+{
+    for (int i = 1; i < count; i++) {
+        if (compareVessels(&vessels[i - 1], &vessels[i]) > 0) {
+            return 0;
+        }
     }
-    fclose(fp);
+    return 1;
+}
 
-    /* Sort vessels by name for consistent ordering */
-    qsort(fleet, *totalCount, sizeof(Vessel*), compareVessels);
+/* Where boat sits in a name-ordered array, by binary search */
+static int arrayPosition(const Fleet* fleet, const Vessel* boat)
+{
+    int lo = 0;
+    int hi = fleet->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(fleet->vessels[mid]->foldedName, boat->foldedName) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    while (fleet->vessels[lo] != boat) {
+        lo++;
+    }
+    return lo;
 }
 
 /*
- * Write updated vessel info back to CSV file
+ * Add boats with random names to a fleet of rows and remove them again,
+ * once keeping a sorted array by shifting its tail as the fleet used to
+ * and once through the B+tree
  */
-void saveData(const char* fileName, Vessel** fleet, int totalCount)
+static void benchInsert(long rows)
 {
-    FILE* fp = fopen(fileName, "w");
-    if (!fp) {
-        printf("Error: Could not open file %s for writing.\n", fileName);
+    static const char* methods[] = { "array", "b+tree" };
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
         return;
     }
+    printf("Ordered insert and remove with %ld vessels\n", rows);
+    printf("%-8s %8s %14s %14s %8s\n", "method", "boats", "ns/add", "ns/remove", "ordered");
 
-    for (int i = 0; i < totalCount; i++) {
-        Vessel* v = fleet[i];
-        fprintf(fp, "%s,%.0f,%s,", 
-                v->vesselName,
-                v->lengthFt,
-                locationCategoryToStr(v->locationCat));
+    for (int method = 0; method < 2; method++) {
+        Fleet fleet;
+        fleetInit(&fleet);
+        loadFleetBuffer(&fleet, data, len);
 
-        switch (v->locationCat) {
-            case SLIP:
-                fprintf(fp, "%d", v->locationInfo.slipNo);
-                break;
-            case LAND:
-                fprintf(fp, "%c", v->locationInfo.bayLabel);
-                break;
-            case TRAILOR:
-                fprintf(fp, "%s", v->locationInfo.trailerTag);
-                break;
-            case STORAGE:
-                fprintf(fp, "%d", v->locationInfo.storageSpot);
+        Vessel*  added[BENCH_INSERT_ADDS];
+        long     adds  = 0;
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        double   t0    = nowSeconds();
+        for (; adds < BENCH_INSERT_ADDS; adds++) {
+            char   name[32];
+            Vessel boat;
+            memset(&boat, 0, sizeof(boat));
+            boat.nameLen    = (uint32_t)snprintf(name, sizeof(name), "Added%08x",
+                                                 (unsigned)benchRandom(&state));
+            boat.vesselName = name;
+            if (method == 0) {
+                added[adds] = fleetAdd(&fleet, &boat);
+                if (added[adds]) {
+                    /* Shift the greater names up one slot */
+                    int lo = 0;
+                    int hi = fleet.count - 1;
+                    while (lo < hi) {
+                        int mid = lo + (hi - lo) / 2;
+                        if (compareVessels(&fleet.vessels[mid], &added[adds]) <= 0) {
+                            lo = mid + 1;
+                        } else {
+                            hi = mid;
+                        }
+                    }
+                    memmove(&fleet.vessels[lo + 1], &fleet.vessels[lo],
+                            (size_t)(fleet.count - 1 - lo) * sizeof(Vessel*));
+                    fleet.vessels[lo] = added[adds];
+                }
+            } else {
+                added[adds] = fleetInsert(&fleet, &boat);
+            }
+            if (!added[adds]) {
                 break;
+            }
         }
-        fprintf(fp, ",%.2f\n", v->outstandingFees);
-    }
+        double addSeconds = nowSeconds() - t0;
+        int    ordered    = fleet.count == (int)rows + adds &&
+                            vesselsSorted(fleetLiveVessels(&fleet), fleet.count);
 
-    fclose(fp);
+        t0 = nowSeconds();
+        for (long i = 0; i < adds; i++) {
+            if (method == 0) {
+                int pos = arrayPosition(&fleet, added[i]);
+                memmove(&fleet.vessels[pos], &fleet.vessels[pos + 1],
+                        (size_t)(fleet.count - pos - 1) * sizeof(Vessel*));
+                fleet.count--;
+            } else {
+                fleetRemove(&fleet, added[i]);
+            }
+        }
+        double   removeSeconds = nowSeconds() - t0;
+        Vessel** live          = fleetLiveVessels(&fleet);
+        ordered = ordered && fleet.count == (int)rows && vesselsSorted(live, fleet.count);
+
+        printf("%-8s %8ld %14.1f %14.1f %8s\n", methods[method], adds,
+               adds ? addSeconds * 1e9 / (double)adds : 0.0,
+               adds ? removeSeconds * 1e9 / (double)adds : 0.0, ordered ? "yes" : "NO");
+        freeVesselMemory(&fleet);
+    }
+    free(data);
 }
 
-/* List vessels in alphabetical order */
-void listAllVessels(Vessel** fleet, int totalCount)
-{
-    for (int i = 0; i < totalCount; i++) {
-        Vessel* v = fleet[i];
-        printf("%-20s %3.0f' ", v->vesselName, v->lengthFt);
+#define BENCH_REMOVE_SHARE   2          /* remove 1 in this many boats */
 
-        switch (v->locationCat) {
-            case SLIP:
-                printf("%8s   # %2d", "slip", v->locationInfo.slipNo);
-                break;
-            case LAND:
-                printf("%8s      %c", "land", v->locationInfo.bayLabel);
-                break;
-            case TRAILOR:
-                printf("%8s %6s", "trailor", v->locationInfo.trailerTag);
-                break;
-            case STORAGE:
-                printf("%8s   # %2d", "storage", v->locationInfo.storageSpot);
-                break;
-        }
-        printf("   Owes $%7.2f\n", v->outstandingFees);
-    }
-    printf("\n");
+/* Take a boat out of the tree at once, as removals did before tombstones */
+static void unlinkVessel(Fleet* fleet, Vessel* boat)
+{
+    treeRemove(&fleet->order, boat);
+    nameIndexRemove(&fleet->index, boat, &fleet->order);
+    locationIndexRemove(&fleet->locations, boat);
+    poolFree(&fleet->pool, boat);
+    fleet->count--;
+    fleet->vesselsStale = 1;
 }
 
 /*
- * Insert a new boat from a CSV-style string
+ * Remove a share of a fleet of rows in random order, unlinking each boat
+ * from the tree at once and then as tombstones, and time the billing pass
+ * that follows
  */
-void insertVessel(Vessel** fleet, int* totalCount, const char* csvLine)
+static void benchRemove(long rows)
 {
-    if (*totalCount >= MAX_VESSELS) {
-        printf("Error: Maximum capacity reached.\n\n");
+    static const char* methods[] = { "unlink", "tombstone" };
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
         return;
     }
+    printf("Removing 1 in %d of %ld vessels\n", BENCH_REMOVE_SHARE, rows);
+    printf("%-10s %10s %14s %12s %8s\n", "method", "removed", "ns/remove", "bill ms", "ordered");
 
-    Vessel* newBoat = (Vessel*)malloc(sizeof(Vessel));
-    if (!newBoat) {
-        printf("Error: Memory allocation problem.\n\n");
-        return;
-    }
+    for (int method = 0; method < 2; method++) {
+        Fleet fleet;
+        fleetInit(&fleet);
+        loadFleetBuffer(&fleet, data, len);
 
-    char buffer[256];
-    strncpy(buffer, csvLine, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
+        int      removes = fleet.count / BENCH_REMOVE_SHARE;
+        Vessel** victims = (Vessel**)malloc((size_t)fleet.count * sizeof(Vessel*) + 1);
+        if (!victims) {
+            printf("Error: memory allocation failed.\n");
+            freeVesselMemory(&fleet);
+            break;
+        }
+        memcpy(victims, fleet.vessels, (size_t)fleet.count * sizeof(Vessel*));
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = fleet.count - 1; i > 0; i--) {
+            int     j   = (int)(benchRandom(&state) % (uint64_t)(i + 1));
+            Vessel* tmp = victims[i];
+            victims[i]  = victims[j];
+            victims[j]  = tmp;
+        }
 
-    char* token;
-    char* rest = buffer;
+        double t0 = nowSeconds();
+        for (int i = 0; i < removes; i++) {
+            if (method == 0) {
+                unlinkVessel(&fleet, victims[i]);
+            } else {
+                fleetRemove(&fleet, victims[i]);
+            }
+        }
+        double removeSeconds = nowSeconds() - t0;
 
-    /* Vessel name */
-    token = strtok_r(rest, ",", &rest);
-    if (!token) {
-        free(newBoat);
-        printf("Error: Invalid CSV format.\n\n");
-        return;
-    }
-    strncpy(newBoat->vesselName, token, MAX_VESSEL_NAME_LEN - 1);
-    newBoat->vesselName[MAX_VESSEL_NAME_LEN - 1] = '\0';
+        t0 = nowSeconds();
+        chargeMonthlyFees(&fleet, 1, NULL);
+        double billSeconds = nowSeconds() - t0;
 
-    /* Vessel length */
-    token = strtok_r(rest, ",", &rest);
-    if (!token) {
-        free(newBoat);
-        printf("Error: Invalid CSV format.\n\n");
-        return;
+        Vessel** live    = fleetLiveVessels(&fleet);
+        int      ordered = fleet.count == (int)rows - removes &&
+                           vesselsSorted(live, fleet.count);
+        printf("%-10s %10d %14.1f %12.2f %8s\n", methods[method], removes,
+               removes ? removeSeconds * 1e9 / removes : 0.0, billSeconds * 1e3,
+               ordered ? "yes" : "NO");
+        free(victims);
+        freeVesselMemory(&fleet);
     }
-    newBoat->lengthFt = (float)atof(token);
+    free(data);
+}
 
-    /* Location category */
-    token = strtok_r(rest, ",", &rest);
-    if (!token) {
-        free(newBoat);
-        printf("Error: Invalid CSV format.\n\n");
-        return;
+#define BENCH_LOOKUP_QUERIES 1000000
+
+/*
+ * Load a synthetic fleet of rows for a query benchmark.  Returns -1, with
+ * nothing left to free, if it could not be built or came out empty.
+ */
+static int benchQueryFleet(Fleet* fleet, long rows)
+{
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
+        return -1;
     }
-    if (strcasecmp(token, "slip") == 0) {
-        newBoat->locationCat = SLIP;
-        token = strtok_r(rest, ",", &rest);
-        if (!token) {
-            free(newBoat);
-            printf("Error: Incomplete data.\n\n");
-            return;
-        }
-        newBoat->locationInfo.slipNo = atoi(token);
-    } else if (strcasecmp(token, "land") == 0) {
-        newBoat->locationCat = LAND;
-        token = strtok_r(rest, ",", &rest);
-        if (!token || strlen(token) == 0) {
-            free(newBoat);
-            printf("Error: Incomplete data.\n\n");
-            return;
-        }
-        newBoat->locationInfo.bayLabel = token[0];
-    } else if (strcasecmp(token, "trailor") == 0) {
-        newBoat->locationCat = TRAILOR;
-        token = strtok_r(rest, ",", &rest);
-        if (!token) {
-            free(newBoat);
-            printf("Error: Incomplete data.\n\n");
-            return;
-        }
-        strncpy(newBoat->locationInfo.trailerTag, token, 9);
-        newBoat->locationInfo.trailerTag[9] = '\0';
-    } else if (strcasecmp(token, "storage") == 0) {
-        newBoat->locationCat = STORAGE;
-        token = strtok_r(rest, ",", &rest);
-        if (!token) {
-            free(newBoat);
-            printf("Error: Incomplete data.\n\n");
-            return;
-        }
-        newBoat->locationInfo.storageSpot = atoi(token);
-    } else {
-        free(newBoat);
-        printf("Error: Unknown location.\n\n");
-        return;
+    fleetInit(fleet);
+    loadFleetBuffer(fleet, data, len);
+    free(data);
+    if (fleet->count == 0) {
+        freeVesselMemory(fleet);
+        return -1;
     }
+    return 0;
+}
 
-    /* Outstanding fees */
-    token = strtok_r(rest, ",", &rest);
-    if (!token) {
-        free(newBoat);
-        printf("Error: Missing fee data.\n\n");
-        return;
+/*
+ * How many queries a linear scan over count vessels gets: about 10^8
+ * vessels visited in all, but at least 16 and at most limit
+ */
+static long benchScanQueries(int count, long limit)
+{
+    long scans = 100000000L / count;
+    if (scans < 16) {
+        scans = 16;
+    } else if (scans > limit) {
+        scans = limit;
     }
-    newBoat->outstandingFees = (float)atof(token);
+    return scans;
+}
 
-    /* Add the new vessel and sort again */
-    fleet[*totalCount] = newBoat;
-    (*totalCount)++;
-    qsort(fleet, *totalCount, sizeof(Vessel*), compareVessels);
+/* The linear search locateVesselByName used to do, kept for comparison */
+static int scanVesselsByName(const Fleet* fleet, const char* searchName)
+{
+    char   folded[MAX_INPUT_LEN];
+    size_t len = strlen(searchName);
+    if (len >= sizeof(folded)) {
+        return -1;
+    }
+    foldName(folded, searchName, len);
+    for (int i = 0; i < fleet->count; i++) {
+        if (strcmp(fleet->vessels[i]->foldedName, folded) == 0) {
+            return i;
+        }
+    }
+    return -1;
 }
 
 /*
- * Delete a boat entry by its name
+ * Time name lookups by linear scan and through the hash index at 1K, 100K
+ * and rows vessels (-n 10000000 for the 10M point).  Queries are names of
+ * random vessels in their original case.  Scans are capped so the large
+ * fleets finish in reasonable time.
  */
-void removeVessel(Vessel** fleet, int* totalCount)
+static void benchLookup(long rows)
 {
-    char targetName[MAX_VESSEL_NAME_LEN];
-    printf("Please enter the boat name                               : ");
-    if (fgets(targetName, sizeof(targetName), stdin) != NULL) {
-        targetName[strcspn(targetName, "\n")] = '\0';
+    long sizes[] = { 1000, 100000, rows };
+    long last    = 0;
 
-        int idx = locateVesselByName(fleet, *totalCount, targetName);
-        if (idx == -1) {
-            printf("No boat with that name\n\n");
-            return;
+    printf("Name lookup, ns per lookup\n");
+    printf("%10s %14s %12s %10s %10s\n", "vessels", "linear scan", "hash index", "scan hits",
+           "hash hits");
+    for (int s = 0; s < 3; s++) {
+        long size = sizes[s];
+        if (size > rows || size <= last) {
+            continue;
+        }
+        last = size;
+        Fleet fleet;
+        if (benchQueryFleet(&fleet, size) != 0) {
+            continue;
         }
-        free(fleet[idx]);
-        for (int i = idx; i < (*totalCount) - 1; i++) {
-            fleet[i] = fleet[i + 1];
+
+        long     scans     = benchScanQueries(fleet.count, BENCH_LOOKUP_QUERIES);
+        uint64_t state     = 0x2545F4914F6CDD1DULL;
+        long     scanFound = 0;
+        double   t0        = nowSeconds();
+        for (long q = 0; q < scans; q++) {
+            const char* name = fleet.vessels[benchRandom(&state) % fleet.count]->vesselName;
+            scanFound += scanVesselsByName(&fleet, name) != -1;
+        }
+        double scanSeconds = nowSeconds() - t0;
+
+        long hashFound = 0;
+        state = 0x2545F4914F6CDD1DULL;
+        t0    = nowSeconds();
+        for (long q = 0; q < BENCH_LOOKUP_QUERIES; q++) {
+            const char* name = fleet.vessels[benchRandom(&state) % fleet.count]->vesselName;
+            hashFound += findVesselByName(&fleet, name) != NULL;
         }
-        (*totalCount)--;
+        double hashSeconds = nowSeconds() - t0;
+
+        printf("%10d %14.1f %12.1f %10ld %10ld\n", fleet.count,
+               scanSeconds * 1e9 / (double)scans, hashSeconds * 1e9 / BENCH_LOOKUP_QUERIES,
+               scanFound, hashFound);
+        freeVesselMemory(&fleet);
     }
 }
 
+#define BENCH_PREFIX_QUERIES 100000
+
 /*
- * Accept a payment up to the total owed
+ * Prefix queries against a fleet of rows: the start of a random boat's
+ * name, all but its last two characters, matched by scanning every name
+ * and through the tree's name order.  Scans are capped on big fleets.
  */
-void recordPayment(Vessel** fleet, int totalCount)
+static void benchPrefix(long rows)
 {
-    char  inputName[MAX_VESSEL_NAME_LEN];
-    float amount;
-    printf("Please enter the boat name: ");
-    if (fgets(inputName, sizeof(inputName), stdin) != NULL) {
-        inputName[strcspn(inputName, "\n")] = '\0';
-        int index = locateVesselByName(fleet, totalCount, inputName);
-        if (index == -1) {
-            printf("No boat with that name\n\n");
-            return;
+    Fleet fleet;
+    if (benchQueryFleet(&fleet, rows) != 0) {
+        return;
+    }
+
+    long     scans       = benchScanQueries(fleet.count, BENCH_PREFIX_QUERIES);
+    char     prefix[MAX_INPUT_LEN];
+    uint64_t state       = 0x2545F4914F6CDD1DULL;
+    long     scanMatches = 0;
+    double   t0          = nowSeconds();
+    for (long q = 0; q < scans; q++) {
+        const Vessel* pick = fleet.vessels[benchRandom(&state) % fleet.count];
+        size_t        n    = pick->nameLen > 2 ? pick->nameLen - 2 : pick->nameLen;
+        for (int i = 0; i < fleet.count; i++) {
+            scanMatches += strncasecmp(fleet.vessels[i]->vesselName, pick->vesselName, n) == 0;
         }
-        printf("Please enter the amount to be paid: ");
-        char buf[50];
-        if (fgets(buf, sizeof(buf), stdin) != NULL) {
-            amount = (float)atof(buf);
-            
-            if (amount >= fleet[index]->outstandingFees) {
-                printf("That is more than the amount owed, $%.2f\n\n",
-                       fleet[index]->outstandingFees);
-                return;
-            }
-            fleet[index]->outstandingFees -= amount;
+    }
+    double scanSeconds = nowSeconds() - t0;
+
+    long treeMatches = 0;
+    state = 0x2545F4914F6CDD1DULL;
+    t0    = nowSeconds();
+    for (long q = 0; q < BENCH_PREFIX_QUERIES; q++) {
+        const Vessel* pick = fleet.vessels[benchRandom(&state) % fleet.count];
+        size_t        n    = pick->nameLen > 2 ? pick->nameLen - 2 : pick->nameLen;
+        PrefixSearch  search;
+        memcpy(prefix, pick->vesselName, n);
+        prefix[n] = '\0';
+        prefixSearchStart(&fleet, prefix, &search);
+        while (prefixSearchNext(&search)) {
+            treeMatches++;
         }
     }
+    double treeSeconds = nowSeconds() - t0;
+
+    printf("Prefix search over %d vessels\n", fleet.count);
+    printf("%-12s %8s %14s %14s\n", "method", "queries", "ns/query", "matches/query");
+    printf("%-12s %8ld %14.1f %14.1f\n", "linear scan", scans, scanSeconds * 1e9 / (double)scans,
+           (double)scanMatches / (double)scans);
+    printf("%-12s %8d %14.1f %14.1f\n", "name order", BENCH_PREFIX_QUERIES,
+           treeSeconds * 1e9 / BENCH_PREFIX_QUERIES,
+           (double)treeMatches / BENCH_PREFIX_QUERIES);
+    freeVesselMemory(&fleet);
 }
 
+#define BENCH_LOCATE_QUERIES 100000
+
 /*
- * Add monthly charges for each vessel
+ * "Who is in slip n" against a fleet of rows, for random slips, answered
+ * by scanning every boat's location and through the location index.
+ * Scans are capped on big fleets.
  */
-void applyMonthlyFees(Vessel** fleet, int totalCount)
+static void benchLocate(long rows)
 {
-    for (int i = 0; i < totalCount; i++) {
-        Vessel* v = fleet[i];
-        float monthlyCharge = 0.0f;
-        switch (v->locationCat) {
-            case SLIP:
-                monthlyCharge = v->lengthFt * RATE_SLIP;
-                break;
-            case LAND:
-                monthlyCharge = v->lengthFt * RATE_LAND;
-                break;
-            case TRAILOR:
-                monthlyCharge = v->lengthFt * RATE_TRAILER;
-                break;
-            case STORAGE:
-                monthlyCharge = v->lengthFt * RATE_STORAGE;
-                break;
+    Fleet fleet;
+    if (benchQueryFleet(&fleet, rows) != 0) {
+        return;
+    }
+
+    long     scans       = benchScanQueries(fleet.count, BENCH_LOCATE_QUERIES);
+    uint64_t state       = 0x2545F4914F6CDD1DULL;
+    long     scanMatches = 0;
+    double   t0          = nowSeconds();
+    for (long q = 0; q < scans; q++) {
+        int slip = 1 + (int)(benchRandom(&state) % MAX_SLIP_NUM);
+        for (int i = 0; i < fleet.count; i++) {
+            const Vessel* v = fleet.vessels[i];
+            scanMatches += v->locationCat == SLIP && v->locationInfo.slipNo == slip;
         }
-        v->outstandingFees += monthlyCharge;
     }
-    printf("\n");
+    double scanSeconds = nowSeconds() - t0;
+
+    long indexMatches = 0;
+    state = 0x2545F4914F6CDD1DULL;
+    t0    = nowSeconds();
+    for (long q = 0; q < BENCH_LOCATE_QUERIES; q++) {
+        LocDetails where;
+        where.slipNo = 1 + (int)(benchRandom(&state) % MAX_SLIP_NUM);
+        const LocationList* there = locationIndexFind(&fleet.locations, SLIP, &where);
+        for (const Vessel* v = there ? there->head : NULL; v; v = v->locNext) {
+            indexMatches++;
+        }
+    }
+    double indexSeconds = nowSeconds() - t0;
+
+    printf("Slip queries over %d vessels\n", fleet.count);
+    printf("%-12s %8s %14s %14s\n", "method", "queries", "ns/query", "boats/query");
+    printf("%-12s %8ld %14.1f %14.1f\n", "linear scan", scans, scanSeconds * 1e9 / (double)scans,
+           (double)scanMatches / (double)scans);
+    printf("%-12s %8d %14.1f %14.1f\n", "index", BENCH_LOCATE_QUERIES,
+           indexSeconds * 1e9 / BENCH_LOCATE_QUERIES,
+           (double)indexMatches / BENCH_LOCATE_QUERIES);
+    freeVesselMemory(&fleet);
 }
 
-/*
- * Convert the enum to a string
- */
-char* locationCategoryToStr(LocationCategory lc)
+#define BENCH_ALLOCATE_QUERIES 1000000
+
+/* The lowest slip no boat is in, by marking every boat's slip first */
+static int scanFreeSlip(Fleet* fleet)
 {
-    switch (lc) {
-        case SLIP:    return "slip";
-        case LAND:    return "land";
-        case TRAILOR: return "trailor";
-        case STORAGE: return "storage";
-        default:      return "unknown";
+    char     taken[MAX_SLIP_NUM + 1] = { 0 };
+    Vessel** vessels                 = fleetVessels(fleet);
+    for (int i = 0; i < fleet->count; i++) {
+        const Vessel* v = vessels[i];
+        if (!v->removed && v->locationCat == SLIP && v->locationInfo.slipNo >= 1 &&
+            v->locationInfo.slipNo <= MAX_SLIP_NUM) {
+            taken[v->locationInfo.slipNo] = 1;
+        }
+    }
+    for (int slip = 1; slip <= MAX_SLIP_NUM; slip++) {
+        if (!taken[slip]) {
+            return slip;
+        }
     }
+    return 0;
 }
 
 /*
- * Return the index of a boat by name
+ * Find the lowest free slip for a check-in, in a fleet of rows whose upper
+ * half of slips has been emptied, by scanning the fleet and through the
+ * taken set.  Each slip found through the taken set is filled and emptied
+ * again, as a check-in and check-out would.  Scans are capped on big
+ * fleets.
  */
-int locateVesselByName(Vessel** fleet, int totalCount, const char* searchName)
+static void benchAllocate(long rows)
 {
-    for (int i = 0; i < totalCount; i++) {
-        if (strcasecmp(fleet[i]->vesselName, searchName) == 0) {
-            return i;
+    Fleet fleet;
+    if (benchQueryFleet(&fleet, rows) != 0) {
+        return;
+    }
+
+    Vessel** leaving = (Vessel**)malloc((size_t)fleet.count * sizeof(Vessel*) + 1);
+    int      leaves  = 0;
+    if (!leaving) {
+        printf("Error: memory allocation failed.\n");
+        freeVesselMemory(&fleet);
+        return;
+    }
+    for (int i = 0; i < fleet.count; i++) {
+        const Vessel* v = fleet.vessels[i];
+        if (v->locationCat == SLIP && v->locationInfo.slipNo > MAX_SLIP_NUM / 2) {
+            leaving[leaves++] = fleet.vessels[i];
         }
     }
-    return -1;
+    for (int i = 0; i < leaves; i++) {
+        fleetRemove(&fleet, leaving[i]);
+    }
+    free(leaving);
+    fleetPurge(&fleet);
+    if (fleet.count == 0) {
+        freeVesselMemory(&fleet);
+        return;
+    }
+
+    long   scans     = benchScanQueries(fleet.count, BENCH_ALLOCATE_QUERIES);
+    long   scanFound = 0;
+    double t0        = nowSeconds();
+    for (long q = 0; q < scans; q++) {
+        scanFound += scanFreeSlip(&fleet);
+    }
+    double scanSeconds = nowSeconds() - t0;
+
+    Vessel guest;
+    long   bitsFound = 0;
+    memset(&guest, 0, sizeof(guest));
+    guest.locationCat = SLIP;
+    t0 = nowSeconds();
+    for (long q = 0; q < BENCH_ALLOCATE_QUERIES; q++) {
+        guest.locationInfo.slipNo = locationIndexFirstFree(&fleet.locations, SLIP);
+        bitsFound += guest.locationInfo.slipNo;
+        locationIndexAdd(&fleet.locations, &guest);
+        locationIndexRemove(&fleet.locations, &guest);
+    }
+    double bitsSeconds = nowSeconds() - t0;
+
+    printf("Free slip queries over %d vessels, lowest free slip %d\n", fleet.count,
+           locationIndexFirstFree(&fleet.locations, SLIP));
+    printf("%-12s %8s %14s %8s\n", "method", "queries", "ns/query", "agree");
+    printf("%-12s %8ld %14.1f %8s\n", "fleet scan", scans, scanSeconds * 1e9 / (double)scans,
+           scanFound == scans * (long)scanFreeSlip(&fleet) ? "yes" : "NO");
+    printf("%-12s %8d %14.1f %8s\n", "bitset", BENCH_ALLOCATE_QUERIES,
+           bitsSeconds * 1e9 / BENCH_ALLOCATE_QUERIES,
+           bitsFound == BENCH_ALLOCATE_QUERIES * (long)scanFreeSlip(&fleet) ? "yes" : "NO");
+    freeVesselMemory(&fleet);
 }
 
+#define BENCH_ACCRUAL_MONTHS 12
+
 /*
- * Used by qsort to compare names
+ * Bill a year month by month over the same fleet loaded twice: once
+ * charging every vessel each month, once deferring the charges and
+ * settling all of them at the end, as a save would
  */
-int compareVessels(const void* a, const void* b)
+static void benchAccrual(long rows)
 {
-    Vessel* va = *(Vessel**)a;
-    Vessel* vb = *(Vessel**)b;
-    return strcasecmp(va->vesselName, vb->vesselName);
+    size_t len;
+    char*  data = generateSyntheticFleet(rows, &len);
+    Fleet  eager;
+    Fleet  lazy;
+    if (!data) {
+        printf("Error: memory allocation failed.\n");
+        return;
+    }
+    fleetInit(&eager);
+    fleetInit(&lazy);
+    lazy.deferBilling = 1;
+    loadFleetBuffer(&eager, data, len);
+    loadFleetBuffer(&lazy, data, len);
+    free(data);
+    printf("Monthly accrual, %d vessels, %d months\n", eager.count, BENCH_ACCRUAL_MONTHS);
+    printf("%-10s %14s %14s %16s\n", "billing", "ns/month", "settle ms", "checksum");
+
+    double t0 = nowSeconds();
+    for (int m = 0; m < BENCH_ACCRUAL_MONTHS; m++) {
+        accrueMonth(&eager, 1);
+    }
+    double  monthSeconds = nowSeconds() - t0;
+    int64_t checksum     = sumFees(eager.vessels, eager.count);
+    printf("%-10s %14.1f %14.3f %16" PRId64 "\n", "eager",
+           monthSeconds * 1e9 / BENCH_ACCRUAL_MONTHS, 0.0, checksum);
+
+    t0 = nowSeconds();
+    for (int m = 0; m < BENCH_ACCRUAL_MONTHS; m++) {
+        accrueMonth(&lazy, 1);
+    }
+    monthSeconds = nowSeconds() - t0;
+    t0 = nowSeconds();
+    settleFleet(&lazy);
+    double settleSeconds = nowSeconds() - t0;
+    checksum = sumFees(lazy.vessels, lazy.count);
+    printf("%-10s %14.1f %14.3f %16" PRId64 "\n", "deferred",
+           monthSeconds * 1e9 / BENCH_ACCRUAL_MONTHS, settleSeconds * 1e3, checksum);
+
+    freeVesselMemory(&eager);
+    freeVesselMemory(&lazy);
 }
 
 /*
- * Free up all dynamically allocated memory
+ * Run one of the synthetic benchmarks selected with -B
  */
-void freeVesselMemory(Vessel** fleet, int totalCount)
+void runBenchmark(const char* name, long rows, int workers)
 {
-    for (int i = 0; i < totalCount; i++) {
-        free(fleet[i]);
+    if (rows < 1) {
+        printf("Error: row count must be positive.\n");
+        return;
+    }
+    if (strcmp(name, "scan") == 0) {
+        benchScanner(rows);
+    } else if (strcmp(name, "numparse") == 0) {
+        benchNumberParsing(rows);
+    } else if (strcmp(name, "fleet") == 0) {
+        benchFleet(rows);
+    } else if (strcmp(name, "alloc") == 0) {
+        benchAllocator(rows);
+    } else if (strcmp(name, "billing") == 0) {
+        benchBilling(rows, workers);
+    } else if (strcmp(name, "accrual") == 0) {
+        benchAccrual(rows);
+    } else if (strcmp(name, "lookup") == 0) {
+        benchLookup(rows);
+    } else if (strcmp(name, "insert") == 0) {
+        benchInsert(rows);
+    } else if (strcmp(name, "remove") == 0) {
+        benchRemove(rows);
+    } else if (strcmp(name, "prefix") == 0) {
+        benchPrefix(rows);
+    } else if (strcmp(name, "locate") == 0) {
+        benchLocate(rows);
+    } else if (strcmp(name, "allocate") == 0) {
+        benchAllocate(rows);
+    } else {
+        printf("Unknown benchmark %s (available: scan, numparse, fleet, alloc, billing, "
+               "accrual, lookup, insert, remove, prefix, locate, allocate)\n", name);
     }
 }